@@ -2,7 +2,11 @@
 #define AST_H
 
 #include <concepts>
+#include <cstddef>
 #include <memory>
+#include <optional>
+#include <variant>
+#include <vector>
 
 namespace AST {
     enum class NodeType {
@@ -14,9 +18,16 @@ namespace AST {
         GREATER_THAN,
         AND,
         OR,
-        IF
+        IF,
+        PARAMETER,
+        SUM,
+        ALL,
+        ANY
     };
 
+    /// Number of NodeType enumerators, the last one has to be used here.
+    constexpr std::size_t NODE_TYPE_COUNT = static_cast<std::size_t>(NodeType::ANY) + 1;
+
     enum class ValueType {
         BOOLEAN,
         NUMBER,
@@ -25,6 +36,19 @@ namespace AST {
 
     class Node;
 
+    /// Receives the node allocations of the current thread while installed, see MemoryAccount in memory.h.
+    struct IAllocationObserver {
+        virtual void allocated(std::size_t bytes) = 0;
+        virtual void freed(std::size_t bytes) = 0;
+        virtual void created(NodeType nodeType) = 0;
+        virtual void destroyed(NodeType nodeType) = 0;
+        virtual void reductionStep() = 0;
+
+        virtual ~IAllocationObserver() = default;
+    };
+
+    inline thread_local IAllocationObserver *allocationObserver = nullptr;
+
     template<class T>
     concept is_node = std::is_base_of<Node, T>::value &&
         requires()
@@ -38,12 +62,33 @@ namespace AST {
 
         using Ptr = std::unique_ptr<Node>;
 
-        explicit Node(NodeType nodeType) : nodeType(nodeType) {}
+        explicit Node(NodeType nodeType) : nodeType(nodeType) {
+            if (allocationObserver) allocationObserver->created(nodeType);
+        }
+
+        virtual ~Node() {
+            if (allocationObserver) allocationObserver->destroyed(nodeType);
+        }
+
+        static void *operator new(std::size_t bytes) {
+            if (allocationObserver) allocationObserver->allocated(bytes);
+            return ::operator new(bytes);
+        }
+
+        static void operator delete(void *pointer, std::size_t bytes) {
+            if (allocationObserver) allocationObserver->freed(bytes);
+            ::operator delete(pointer, bytes);
+        }
 
         template<is_node N>
         N *as() {
             return N::NODE_TYPE == nodeType ? static_cast<N *>(this) : nullptr;
         }
+
+        template<is_node N>
+        const N *as() const {
+            return N::NODE_TYPE == nodeType ? static_cast<const N *>(this) : nullptr;
+        }
     };
 
 
@@ -67,6 +112,13 @@ namespace AST {
         explicit BooleanNode(bool value) : value(value) {}
     };
 
+    /// Placeholder for the input bound to the slot when a prepared program is evaluated.
+    struct ParameterNode : public NodeBase<NodeType::PARAMETER> {
+        std::size_t slot;
+
+        explicit ParameterNode(std::size_t slot) : slot(slot) {}
+    };
+
     template<NodeType nodeType_>
     struct BinaryOpBase : public NodeBase<nodeType_> {
         Node::Ptr left, right;
@@ -97,6 +149,51 @@ namespace AST {
         using BinaryOpBase_t::BinaryOpBase;
     };
 
+    /// Allocates like std::allocator, reporting to the allocation observer like the nodes themselves.
+    template<class T>
+    struct ObservedAllocator {
+        using value_type = T;
+
+        ObservedAllocator() = default;
+
+        template<class U>
+        ObservedAllocator(const ObservedAllocator<U> &) noexcept {}
+
+        T *allocate(std::size_t count) {
+            if (allocationObserver) allocationObserver->allocated(count * sizeof(T));
+            return std::allocator<T>().allocate(count);
+        }
+
+        void deallocate(T *pointer, std::size_t count) {
+            if (allocationObserver) allocationObserver->freed(count * sizeof(T));
+            std::allocator<T>().deallocate(pointer, count);
+        }
+
+        friend bool operator==(const ObservedAllocator &, const ObservedAllocator &) = default;
+    };
+
+    /// The operand array is a separate allocation, so that it is recorded by the allocation observer as well.
+    using Operands = std::vector<Node::Ptr, ObservedAllocator<Node::Ptr>>;
+
+    /// Associative operation over any number of operands, created by flattening chains of binary operations.
+    template<NodeType nodeType_>
+    struct NaryOpBase : public NodeBase<nodeType_> {
+        Operands operands;
+        using NaryOpBase_t = NaryOpBase<nodeType_>;
+
+        explicit NaryOpBase(Operands operands) : operands(std::move(operands)) {}
+    };
+
+    struct SumNode : public NaryOpBase<NodeType::SUM> {
+        using NaryOpBase_t::NaryOpBase;
+    };
+    struct AllNode : public NaryOpBase<NodeType::ALL> {
+        using NaryOpBase_t::NaryOpBase;
+    };
+    struct AnyNode : public NaryOpBase<NodeType::ANY> {
+        using NaryOpBase_t::NaryOpBase;
+    };
+
     struct IfNode : NodeBase<NodeType::IF> {
         Node::Ptr condition;
         Node::Ptr whenTrue;
@@ -108,6 +205,80 @@ namespace AST {
               whenFalse(std::move(whenFalse)) {}
     };
 
+    /// The value of a fully reduced program: a number or a boolean.
+    using Value = std::variant<int, bool>;
+
+    /// Calls f with a reference to each owned child pointer of the node, from left to right.
+    template<class F>
+    void for_each_child(Node &node, F &&f) {
+        switch (node.nodeType) {
+            case NodeType::NUMBER_LITERAL:
+            case NodeType::BOOLEAN_LITERAL:
+            case NodeType::PARAMETER:
+                break;
+            case NodeType::ADD: {
+                auto binaryOp = node.as<AddNode>();
+                f(binaryOp->left);
+                f(binaryOp->right);
+                break;
+            }
+            case NodeType::SUBTRACT: {
+                auto binaryOp = node.as<SubtractNode>();
+                f(binaryOp->left);
+                f(binaryOp->right);
+                break;
+            }
+            case NodeType::LESS_THAN: {
+                auto binaryOp = node.as<LessThanNode>();
+                f(binaryOp->left);
+                f(binaryOp->right);
+                break;
+            }
+            case NodeType::GREATER_THAN: {
+                auto binaryOp = node.as<GreaterThanNode>();
+                f(binaryOp->left);
+                f(binaryOp->right);
+                break;
+            }
+            case NodeType::AND: {
+                auto binaryOp = node.as<AndNode>();
+                f(binaryOp->left);
+                f(binaryOp->right);
+                break;
+            }
+            case NodeType::OR: {
+                auto binaryOp = node.as<OrNode>();
+                f(binaryOp->left);
+                f(binaryOp->right);
+                break;
+            }
+            case NodeType::IF: {
+                auto ternaryIf = node.as<IfNode>();
+                f(ternaryIf->condition);
+                f(ternaryIf->whenTrue);
+                f(ternaryIf->whenFalse);
+                break;
+            }
+            case NodeType::SUM: {
+                for (Node::Ptr &operand: node.as<SumNode>()->operands) f(operand);
+                break;
+            }
+            case NodeType::ALL: {
+                for (Node::Ptr &operand: node.as<AllNode>()->operands) f(operand);
+                break;
+            }
+            case NodeType::ANY: {
+                for (Node::Ptr &operand: node.as<AnyNode>()->operands) f(operand);
+                break;
+            }
+        }
+    }
+
+    template<class F>
+    void for_each_child(const Node &node, F &&f) {
+        for_each_child(const_cast<Node &>(node), [&](const Node::Ptr &child) { f(child); });
+    }
+
     static auto Number(int n) {
         return std::make_unique<NumberNode>(n);
     }
@@ -116,6 +287,10 @@ namespace AST {
         return std::make_unique<BooleanNode>(b);
     }
 
+    static auto Parameter(std::size_t slot) {
+        return std::make_unique<ParameterNode>(slot);
+    }
+
     static auto If(AST::Node::Ptr cond, AST::Node::Ptr whenTrue, AST::Node::Ptr whenFalse) {
         return std::make_unique<IfNode>(std::move(cond), std::move(whenTrue), std::move(whenFalse));
     }
@@ -136,6 +311,39 @@ namespace AST {
         return std::make_unique<GreaterThanNode>(std::move(left), std::move(right));
     }
 
+    static auto And(AST::Node::Ptr left, AST::Node::Ptr right) {
+        return std::make_unique<AndNode>(std::move(left), std::move(right));
+    }
+
+    static auto Or(AST::Node::Ptr left, AST::Node::Ptr right) {
+        return std::make_unique<OrNode>(std::move(left), std::move(right));
+    }
+
+    static auto Sum(Operands operands) {
+        return std::make_unique<SumNode>(std::move(operands));
+    }
+
+    static auto All(Operands operands) {
+        return std::make_unique<AllNode>(std::move(operands));
+    }
+
+    static auto Any(Operands operands) {
+        return std::make_unique<AnyNode>(std::move(operands));
+    }
+
+    /// Creates the literal node holding the value.
+    static Node::Ptr Literal(Value value) {
+        if (auto *number = std::get_if<int>(&value)) return Number(*number);
+        return Boolean(std::get<bool>(value));
+    }
+
+    /// Returns the value of a literal node, or nothing if the node still needs reducing.
+    static std::optional<Value> literal_value(const Node &node) {
+        if (auto *number = node.as<NumberNode>()) return number->value;
+        if (auto *boolean = node.as<BooleanNode>()) return boolean->value;
+        return std::nullopt;
+    }
+
 }// namespace AST
 
 #endif
\ No newline at end of file
@@ -0,0 +1,309 @@
+#ifndef L1_ADAPTIVE_H
+#define L1_ADAPTIVE_H
+
+#include "AST.h"
+#include "reductions.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ProgramProfile {
+    std::size_t nodes = 0;
+    std::size_t depth = 0;
+    std::array<std::size_t, AST::NODE_TYPE_COUNT> histogram{};
+
+    [[nodiscard]] std::size_t count(AST::NodeType nodeType) const {
+        return histogram[static_cast<std::size_t>(nodeType)];
+    }
+
+    [[nodiscard]] double ifDensity() const {
+        return nodes == 0 ? 0.0 : static_cast<double>(count(AST::NodeType::IF)) / static_cast<double>(nodes);
+    }
+};
+
+/// Node count, depth and operator histogram of the program, in one pass.
+static ProgramProfile profile(const AST::Node &tree) {
+    ProgramProfile result;
+    auto visit = [&](const AST::Node &node, std::size_t depth, auto &visit) -> void {
+        result.nodes++;
+        result.depth = std::max(result.depth, depth);
+        result.histogram[static_cast<std::size_t>(node.nodeType)]++;
+        AST::for_each_child(node, [&](const AST::Node::Ptr &child) { visit(*child, depth + 1, visit); });
+    };
+    visit(tree, 0, visit);
+    return result;
+}
+
+
+/// Reduces the node with the strategy and returns the wall-clock time it took, in nanoseconds.
+static double elapsed_nanos(const IReducerStrategy &strategy, AST::Node::Ptr &node) {
+    auto start = std::chrono::steady_clock::now();
+    strategy.reduce(node);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/// Routes every program to the engine predicted to reduce it at the lowest cost.
+///
+/// Each engine gets a linear cost model over the program profile: a constant, the node count, the depth and,
+/// from the operator histogram, the number of If nodes, of comparison and logic nodes and of n-ary nodes.
+/// The models are fitted by least squares to the costs of a built-in benchmark in calibrate().
+/// Until then, programs are routed to the first engine. Routing decisions and their costs are recorded.
+/// Costs are measured by the CostMeter, the wall-clock time in nanoseconds by default.
+class AdaptiveReducer : public IReducerStrategy {
+public:
+    static constexpr std::size_t FEATURE_COUNT = 6;
+    using Model = std::array<double, FEATURE_COUNT>;
+    /// Reduces the node with the strategy and returns what it cost
+    using CostMeter = std::function<double(const IReducerStrategy &, AST::Node::Ptr &)>;
+
+    struct Decision {
+        ProgramProfile profile;
+        std::size_t engine;
+        double predictedCost;
+        double actualCost;
+    };
+
+    struct EngineStats {
+        std::string name;
+        Model model;
+        std::uint64_t routed;
+        double totalCost;
+    };
+
+    explicit AdaptiveReducer(std::size_t decisionLogSize = 1024, CostMeter costMeter = elapsed_nanos)
+        : decisionLogSize(decisionLogSize), costMeter(std::move(costMeter)) {}
+
+    /// Engines have to outlive the reducer. Invalidates the calibration.
+    void addEngine(std::string name, const IReducerStrategy &engine) {
+        std::lock_guard lock(mutex);
+        engines.push_back({std::move(name), &engine, {}, 0, 0.0});
+        isCalibrated = false;
+    }
+
+    /// Measures every engine on generated programs of different sizes and shapes and fits the cost models.
+    /// The benchmark runs without holding the lock, so reductions keep being routed by the previous models
+    /// meanwhile. Engines added during the calibration leave the reducer uncalibrated.
+    void calibrate(int repetitions = 3) {
+        std::vector<std::function<AST::Node::Ptr()>> programs;
+        for (int depth = 3; depth <= 9; depth += 2) {
+            programs.emplace_back([depth] { return balanced_sum(depth); });
+        }
+        for (int length: {16, 64, 256, 1024}) {
+            programs.emplace_back([length] { return left_spine(length); });
+            programs.emplace_back([length] { return if_chain(length); });
+            programs.emplace_back([length] { return comparison_chain(length); });
+            programs.emplace_back([length] { return nested_sums(length); });
+        }
+
+        std::vector<Model> features;
+        for (auto &program: programs) features.push_back(featuresOf(profile(*program())));
+
+        std::vector<const IReducerStrategy *> strategies;
+        {
+            std::lock_guard lock(mutex);
+            for (const Engine &engine: engines) strategies.push_back(engine.strategy);
+        }
+
+        std::vector<Model> models;
+        for (const IReducerStrategy *strategy: strategies) {
+            // unmeasured warm-up, so that the first sample does not pay for cold caches
+            for (auto &program: programs) {
+                AST::Node::Ptr node = program();
+                strategy->reduce(node);
+            }
+
+            std::vector<double> costs;
+            for (auto &program: programs) {
+                std::vector<double> samples;
+                for (int i = 0; i < repetitions; ++i) {
+                    AST::Node::Ptr node = program();
+                    samples.push_back(costMeter(*strategy, node));
+                }
+                std::ranges::nth_element(samples, samples.begin() + samples.size() / 2);
+                costs.push_back(samples[samples.size() / 2]);
+            }
+            models.push_back(fit(features, costs));
+        }
+
+        std::lock_guard lock(mutex);
+        // engines are only ever appended, so the benchmarked ones are still the first ones
+        for (std::size_t i = 0; i < models.size(); ++i) engines[i].model = models[i];
+        isCalibrated = engines.size() == models.size();
+    }
+
+    [[nodiscard]] bool calibrated() const {
+        std::lock_guard lock(mutex);
+        return isCalibrated;
+    }
+
+    /// Index of the engine predicted to be the fastest for the profile.
+    [[nodiscard]] std::size_t choose(const ProgramProfile &programProfile) const {
+        std::lock_guard lock(mutex);
+        return chooseLocked(featuresOf(programProfile));
+    }
+
+    void reduce(AST::Node::Ptr &node) const override {
+        ProgramProfile programProfile = profile(*node);
+        Model features = featuresOf(programProfile);
+
+        const IReducerStrategy *strategy;
+        std::size_t chosen;
+        double predicted;
+        {
+            std::lock_guard lock(mutex);
+            assert(!engines.empty() && "AdaptiveReducer needs at least one engine");
+            chosen = chooseLocked(features);
+            strategy = engines[chosen].strategy;
+            predicted = predict(engines[chosen].model, features);
+        }
+
+        double actual = costMeter(*strategy, node);
+
+        std::lock_guard lock(mutex);
+        engines[chosen].routed++;
+        engines[chosen].totalCost += actual;
+        decisionLog.push_back({programProfile, chosen, predicted, actual});
+        if (decisionLog.size() > decisionLogSize) decisionLog.pop_front();
+    }
+
+    /// The most recent routing decisions, oldest first.
+    [[nodiscard]] std::vector<Decision> decisions() const {
+        std::lock_guard lock(mutex);
+        return {decisionLog.begin(), decisionLog.end()};
+    }
+
+    [[nodiscard]] std::vector<EngineStats> engineStats() const {
+        std::lock_guard lock(mutex);
+        std::vector<EngineStats> result;
+        for (const Engine &engine: engines) {
+            result.push_back({engine.name, engine.model, engine.routed, engine.totalCost});
+        }
+        return result;
+    }
+
+private:
+    struct Engine {
+        std::string name;
+        const IReducerStrategy *strategy;
+        Model model;
+        std::uint64_t routed;
+        double totalCost;
+    };
+
+    mutable std::mutex mutex;
+    mutable std::vector<Engine> engines;
+    mutable std::deque<Decision> decisionLog;
+    std::size_t decisionLogSize;
+    CostMeter costMeter;
+    bool isCalibrated = false;
+
+    static Model featuresOf(const ProgramProfile &programProfile) {
+        auto count = [&](std::initializer_list<AST::NodeType> nodeTypes) {
+            std::size_t total = 0;
+            for (AST::NodeType nodeType: nodeTypes) total += programProfile.count(nodeType);
+            return static_cast<double>(total);
+        };
+        return {1.0,
+                static_cast<double>(programProfile.nodes),
+                static_cast<double>(programProfile.depth),
+                count({AST::NodeType::IF}),
+                count({AST::NodeType::LESS_THAN, AST::NodeType::GREATER_THAN, AST::NodeType::AND, AST::NodeType::OR}),
+                count({AST::NodeType::SUM, AST::NodeType::ALL, AST::NodeType::ANY})};
+    }
+
+    static double predict(const Model &model, const Model &features) {
+        double cost = 0;
+        for (std::size_t i = 0; i < FEATURE_COUNT; ++i) cost += model[i] * features[i];
+        return std::max(cost, 0.0);
+    }
+
+    std::size_t chooseLocked(const Model &features) const {
+        if (!isCalibrated) return 0;
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < engines.size(); ++i) {
+            if (predict(engines[i].model, features) < predict(engines[best].model, features)) best = i;
+        }
+        return best;
+    }
+
+    /// Least squares fit of the relative error, so that small programs weigh as much as large ones.
+    /// Slightly regularized so that features constant over the benchmark do not break it.
+    static Model fit(const std::vector<Model> &features, const std::vector<double> &costs) {
+        double normal[FEATURE_COUNT][FEATURE_COUNT + 1] = {};
+        for (std::size_t sample = 0; sample < features.size(); ++sample) {
+            double weight = 1.0 / std::pow(std::max(costs[sample], 1.0), 2);
+            for (std::size_t i = 0; i < FEATURE_COUNT; ++i) {
+                for (std::size_t j = 0; j < FEATURE_COUNT; ++j) normal[i][j] += weight * features[sample][i] * features[sample][j];
+                normal[i][FEATURE_COUNT] += weight * features[sample][i] * costs[sample];
+            }
+        }
+        for (std::size_t i = 0; i < FEATURE_COUNT; ++i) normal[i][i] += 1e-6 * normal[i][i];
+
+        // Gaussian elimination with partial pivoting
+        for (std::size_t column = 0; column < FEATURE_COUNT; ++column) {
+            std::size_t pivot = column;
+            for (std::size_t row = column + 1; row < FEATURE_COUNT; ++row) {
+                if (std::abs(normal[row][column]) > std::abs(normal[pivot][column])) pivot = row;
+            }
+            std::swap(normal[column], normal[pivot]);
+            for (std::size_t row = 0; row < FEATURE_COUNT; ++row) {
+                if (row == column) continue;
+                double factor = normal[row][column] / normal[column][column];
+                for (std::size_t k = column; k <= FEATURE_COUNT; ++k) normal[row][k] -= factor * normal[column][k];
+            }
+        }
+
+        Model model;
+        for (std::size_t i = 0; i < FEATURE_COUNT; ++i) model[i] = normal[i][FEATURE_COUNT] / normal[i][i];
+        return model;
+    }
+
+    static AST::Node::Ptr balanced_sum(int depth) {
+        if (depth == 0) return AST::Number(1);
+        return AST::Add(balanced_sum(depth - 1), balanced_sum(depth - 1));
+    }
+
+    static AST::Node::Ptr left_spine(int length) {
+        AST::Node::Ptr node = AST::Number(0);
+        for (int i = 1; i <= length; ++i) node = AST::Subtract(std::move(node), AST::Number(i));
+        return node;
+    }
+
+    static AST::Node::Ptr if_chain(int length) {
+        AST::Node::Ptr node = AST::Number(0);
+        for (int i = 0; i < length; ++i) {
+            node = AST::If(AST::LessThan(AST::Number(i), AST::Number(i + 1)), std::move(node), AST::Number(i));
+        }
+        return node;
+    }
+
+    /// Or of comparisons which are all false, so that every one of them is evaluated
+    static AST::Node::Ptr comparison_chain(int length) {
+        AST::Node::Ptr node = AST::Boolean(false);
+        for (int i = 0; i < length; ++i) node = AST::Or(std::move(node), AST::GraterThan(AST::Number(i), AST::Number(length)));
+        return node;
+    }
+
+    static AST::Node::Ptr nested_sums(int length) {
+        AST::Operands operands;
+        for (int i = 0; i < length; ++i) {
+            AST::Operands inner;
+            inner.push_back(AST::Number(i));
+            inner.push_back(AST::Number(1));
+            operands.push_back(AST::Sum(std::move(inner)));
+        }
+        return AST::Sum(std::move(operands));
+    }
+};
+
+#endif//L1_ADAPTIVE_H
@@ -0,0 +1,245 @@
+#ifndef L1_CACHE_H
+#define L1_CACHE_H
+
+#include "AST.h"
+#include "reductions.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+static std::uint64_t hash_combine(std::uint64_t seed, std::uint64_t value) {
+    // splitmix64 finalizer, so that small literal values spread over the whole range
+    value += 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return seed ^ value ^ (value >> 31);
+}
+
+/// Hash of the node itself, without its children: the node type and, for literals and parameters, the value or slot.
+static std::uint64_t node_hash(const AST::Node &node) {
+    std::uint64_t hash = hash_combine(0, static_cast<std::uint64_t>(node.nodeType));
+    if (auto *number = node.as<AST::NumberNode>()) return hash_combine(hash, static_cast<std::uint32_t>(number->value));
+    if (auto *boolean = node.as<AST::BooleanNode>()) return hash_combine(hash, boolean->value);
+    if (auto *parameter = node.as<AST::ParameterNode>()) return hash_combine(hash, parameter->slot);
+    return hash;
+}
+
+/// Hash of the whole subtree. Structurally equal trees have equal hashes, independently of their address.
+static std::uint64_t structural_hash(const AST::Node &node) {
+    std::uint64_t hash = node_hash(node);
+    AST::for_each_child(node, [&](const AST::Node::Ptr &child) {
+        hash = hash_combine(hash, structural_hash(*child));
+    });
+    return hash;
+}
+
+
+/// Thread-safe, bounded map from structural hashes to reduced values.
+/// Entries are split into independently locked shards, each evicting with the CLOCK algorithm.
+class EvaluationCache {
+public:
+    struct Stats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t insertions;
+        std::uint64_t evictions;
+    };
+
+    explicit EvaluationCache(std::size_t capacity, std::size_t shardCount = 16)
+        : shards(std::max<std::size_t>(shardCount, 1)) {
+        std::size_t shardCapacity = std::max<std::size_t>((capacity + shards.size() - 1) / shards.size(), 1);
+        for (Shard &shard: shards) {
+            shard.capacity = shardCapacity;
+            shard.entries.reserve(shardCapacity);
+        }
+    }
+
+    std::optional<AST::Value> lookup(std::uint64_t hash) {
+        Shard &shard = shardFor(hash);
+        std::lock_guard lock(shard.mutex);
+
+        auto found = shard.index.find(hash);
+        if (found == shard.index.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        hits.fetch_add(1, std::memory_order_relaxed);
+        Entry &entry = shard.entries[found->second];
+        entry.referenced = true;
+        return entry.value;
+    }
+
+    void insert(std::uint64_t hash, AST::Value value) {
+        Shard &shard = shardFor(hash);
+        std::lock_guard lock(shard.mutex);
+
+        if (auto found = shard.index.find(hash); found != shard.index.end()) {
+            shard.entries[found->second] = {hash, value, true};
+            return;
+        }
+        insertions.fetch_add(1, std::memory_order_relaxed);
+
+        if (shard.entries.size() < shard.capacity) {
+            shard.index.emplace(hash, shard.entries.size());
+            shard.entries.push_back({hash, value, false});
+            return;
+        }
+
+        // Sweep the clock hand, giving every recently used entry a second chance
+        while (shard.entries[shard.hand].referenced) {
+            shard.entries[shard.hand].referenced = false;
+            shard.hand = (shard.hand + 1) % shard.capacity;
+        }
+        evictions.fetch_add(1, std::memory_order_relaxed);
+        shard.index.erase(shard.entries[shard.hand].hash);
+        shard.index.emplace(hash, shard.hand);
+        shard.entries[shard.hand] = {hash, value, false};
+        shard.hand = (shard.hand + 1) % shard.capacity;
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        std::size_t size = 0;
+        for (const Shard &shard: shards) {
+            std::lock_guard lock(shard.mutex);
+            size += shard.entries.size();
+        }
+        return size;
+    }
+
+    [[nodiscard]] Stats stats() const {
+        return {hits.load(), misses.load(), insertions.load(), evictions.load()};
+    }
+
+    void clear() {
+        for (Shard &shard: shards) {
+            std::lock_guard lock(shard.mutex);
+            shard.index.clear();
+            shard.entries.clear();
+            shard.hand = 0;
+        }
+    }
+
+private:
+    struct Entry {
+        std::uint64_t hash;
+        AST::Value value;
+        bool referenced;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::uint64_t, std::size_t> index;
+        std::vector<Entry> entries;
+        std::size_t hand = 0;
+        std::size_t capacity = 1;
+    };
+
+    std::vector<Shard> shards;
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> insertions{0};
+    std::atomic<std::uint64_t> evictions{0};
+
+    Shard &shardFor(std::uint64_t hash) {
+        return shards[(hash >> 32) % shards.size()];
+    }
+};
+
+
+/// Wraps another strategy with an EvaluationCache shared between programs.
+///
+/// Subtrees are looked up from the root downwards, so the first cached ancestor ends the search.
+/// The operands the program evaluates in any case (including the taken If branch and the All/Any operands
+/// up to the deciding one) are reduced through the cache first, so that the value of every reduced
+/// inner subtree is stored and fragments shared between different programs are reused.
+///
+/// Entries are keyed by the 64-bit structural hash alone and are not verified against the tree:
+/// two different subtrees with colliding hashes would share a value. With n distinct subtrees
+/// in the cache this happens with a probability of about n^2 / 2^65.
+class CachingReducer : public IReducerStrategy {
+    const IReducerStrategy &reducer;
+    EvaluationCache &cache;
+
+public:
+    CachingReducer(const IReducerStrategy &reducer, EvaluationCache &cache) : reducer(reducer), cache(cache) {}
+
+    void reduce(AST::Node::Ptr &node) const override {
+        if (AST::literal_value(*node)) return;
+
+        std::vector<Subtree> subtrees;
+        hashSubtrees(*node, subtrees);
+        reduceCached(node, subtrees, 0);
+    }
+
+private:
+    /// Structural hash and node count of a subtree, stored in preorder
+    struct Subtree {
+        std::uint64_t hash;
+        std::size_t size;
+    };
+
+    static std::uint64_t hashSubtrees(const AST::Node &node, std::vector<Subtree> &subtrees) {
+        std::size_t index = subtrees.size();
+        subtrees.push_back({node_hash(node), 1});
+        AST::for_each_child(node, [&](const AST::Node::Ptr &child) {
+            std::size_t childIndex = subtrees.size();
+            std::uint64_t childHash = hashSubtrees(*child, subtrees);
+            subtrees[index].hash = hash_combine(subtrees[index].hash, childHash);
+            subtrees[index].size += subtrees[childIndex].size;
+        });
+        return subtrees[index].hash;
+    }
+
+    /// Reduces the subtree found at subtrees[index], which has not been modified yet.
+    void reduceCached(AST::Node::Ptr &node, const std::vector<Subtree> &subtrees, std::size_t index) const {
+        if (AST::literal_value(*node)) return;
+
+        std::uint64_t hash = subtrees[index].hash;
+        if (auto value = cache.lookup(hash)) {
+            replace_node(node, AST::Literal(*value));
+            return;
+        }
+
+        // Children follow their parent in preorder, each taking the size of its original subtree
+        std::size_t next = index + 1;
+        auto skipChild = [&] { next += subtrees[next].size; };
+        auto reduceChild = [&](AST::Node::Ptr &child) {
+            std::size_t childIndex = next;
+            skipChild();
+            reduceCached(child, subtrees, childIndex);
+        };
+
+        if (auto *ifNode = node->as<AST::IfNode>()) {
+            reduceChild(ifNode->condition);
+            if (auto *condition = ifNode->condition->as<AST::BooleanNode>()) {
+                if (condition->value) {
+                    reduceChild(ifNode->whenTrue);
+                } else {
+                    skipChild();
+                    reduceChild(ifNode->whenFalse);
+                }
+            }
+        } else if (node->nodeType == AST::NodeType::ALL || node->nodeType == AST::NodeType::ANY) {
+            // only up to the operand deciding the result, the others are never evaluated
+            bool stopAt = node->nodeType == AST::NodeType::ANY;
+            bool decided = false;
+            AST::for_each_child(*node, [&](AST::Node::Ptr &operand) {
+                if (decided) return;
+                reduceChild(operand);
+                auto *boolean = operand->as<AST::BooleanNode>();
+                decided = !boolean || boolean->value == stopAt;
+            });
+        } else {
+            AST::for_each_child(*node, reduceChild);
+        }
+
+        reducer.reduce(node);
+        if (auto value = AST::literal_value(*node)) cache.insert(hash, *value);
+    }
+};
+
+#endif//L1_CACHE_H
@@ -0,0 +1,163 @@
+#ifndef L1_INCREMENTAL_H
+#define L1_INCREMENTAL_H
+
+#include "AST.h"
+#include "types.h"
+#include <cassert>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+/// Evaluates a program without consuming it, remembering the value and type of every evaluated subtree.
+/// After an edit only the nodes on the path from the edited subtree to the root are evaluated again.
+///
+/// Subtrees are addressed by paths of child indices from the root, in the order of AST::for_each_child.
+class IncrementalEvaluator {
+    AST::Node::Ptr root;
+    /// Values of the evaluated inner nodes, literals are not stored
+    std::unordered_map<const AST::Node *, AST::Value> values;
+    std::size_t evaluatedNodes = 0;
+
+public:
+    explicit IncrementalEvaluator(AST::Node::Ptr program) : root(std::move(program)) {}
+
+    [[nodiscard]] const AST::Node &program() const { return *root; }
+
+    /// Returns the value of the program, or nothing if it is ill-typed.
+    std::optional<AST::Value> evaluate() {
+        init_types(*root);
+        if (root->type == AST::ValueType::UNKNOWN) return std::nullopt;
+        return valueOf(*root);
+    }
+
+    [[nodiscard]] const AST::Node &at(std::span<const std::size_t> path) const {
+        const AST::Node *node = root.get();
+        for (std::size_t index: path) node = child(const_cast<AST::Node &>(*node), index).get();
+        return *node;
+    }
+
+    /// Replaces the subtree at the path and returns the previous one. An empty path replaces the whole program.
+    AST::Node::Ptr replace(std::span<const std::size_t> path, AST::Node::Ptr subtree) {
+        AST::Node::Ptr *slot = &root;
+        for (std::size_t index: path) {
+            invalidate(**slot);
+            slot = &child(**slot, index);
+        }
+
+        forget(**slot);
+        std::swap(*slot, subtree);
+        return subtree;
+    }
+
+    /// Number of inner nodes evaluated since construction, for verifying that edits stay incremental.
+    [[nodiscard]] std::size_t evaluations() const { return evaluatedNodes; }
+
+private:
+    static AST::Node::Ptr &child(AST::Node &node, std::size_t index) {
+        AST::Node::Ptr *found = nullptr;
+        std::size_t current = 0;
+        AST::for_each_child(node, [&](AST::Node::Ptr &child) {
+            if (current++ == index) found = &child;
+        });
+        assert(found && "path does not exist in the program");
+        return *found;
+    }
+
+    void invalidate(AST::Node &node) {
+        values.erase(&node);
+        node.type = AST::ValueType::UNKNOWN;
+    }
+
+    /// Drops the cached values of a subtree leaving the program, so that the addresses can be reused safely.
+    void forget(const AST::Node &node) {
+        values.erase(&node);
+        AST::for_each_child(node, [&](const AST::Node::Ptr &child) { forget(*child); });
+    }
+
+    static int number(const AST::Value &value) { return std::get<int>(value); }
+
+    static bool boolean(const AST::Value &value) { return std::get<bool>(value); }
+
+    AST::Value valueOf(const AST::Node &node) {
+        if (auto literal = AST::literal_value(node)) return *literal;
+        if (auto found = values.find(&node); found != values.end()) return found->second;
+
+        AST::Value value;
+        switch (node.nodeType) {
+            case AST::NodeType::ADD: {
+                auto binaryOp = node.as<AST::AddNode>();
+                value = number(valueOf(*binaryOp->left)) + number(valueOf(*binaryOp->right));
+                break;
+            }
+            case AST::NodeType::SUBTRACT: {
+                auto binaryOp = node.as<AST::SubtractNode>();
+                value = number(valueOf(*binaryOp->left)) - number(valueOf(*binaryOp->right));
+                break;
+            }
+            case AST::NodeType::LESS_THAN: {
+                auto binaryOp = node.as<AST::LessThanNode>();
+                value = number(valueOf(*binaryOp->left)) < number(valueOf(*binaryOp->right));
+                break;
+            }
+            case AST::NodeType::GREATER_THAN: {
+                auto binaryOp = node.as<AST::GreaterThanNode>();
+                value = number(valueOf(*binaryOp->left)) > number(valueOf(*binaryOp->right));
+                break;
+            }
+            case AST::NodeType::AND: {
+                auto binaryOp = node.as<AST::AndNode>();
+                bool left = boolean(valueOf(*binaryOp->left));
+                bool right = boolean(valueOf(*binaryOp->right));
+                value = left && right;
+                break;
+            }
+            case AST::NodeType::OR: {
+                auto binaryOp = node.as<AST::OrNode>();
+                bool left = boolean(valueOf(*binaryOp->left));
+                bool right = boolean(valueOf(*binaryOp->right));
+                value = left || right;
+                break;
+            }
+            case AST::NodeType::IF: {
+                // the branch that is not taken is not evaluated, as in IfResultReduction
+                auto ternaryIf = node.as<AST::IfNode>();
+                value = boolean(valueOf(*ternaryIf->condition)) ? valueOf(*ternaryIf->whenTrue) : valueOf(*ternaryIf->whenFalse);
+                break;
+            }
+            case AST::NodeType::SUM: {
+                int sum = 0;
+                for (auto &operand: node.as<AST::SumNode>()->operands) sum += number(valueOf(*operand));
+                value = sum;
+                break;
+            }
+            case AST::NodeType::ALL: {
+                bool all = true;
+                for (auto &operand: node.as<AST::AllNode>()->operands) {
+                    if (!(all = boolean(valueOf(*operand)))) break;
+                }
+                value = all;
+                break;
+            }
+            case AST::NodeType::ANY: {
+                bool any = false;
+                for (auto &operand: node.as<AST::AnyNode>()->operands) {
+                    if ((any = boolean(valueOf(*operand)))) break;
+                }
+                value = any;
+                break;
+            }
+            case AST::NodeType::NUMBER_LITERAL:
+            case AST::NodeType::BOOLEAN_LITERAL:
+            case AST::NodeType::PARAMETER:
+                assert(false && "unreachable in a well-typed program");
+                break;
+        }
+
+        evaluatedNodes++;
+        values.emplace(&node, value);
+        return value;
+    }
+};
+
+#endif//L1_INCREMENTAL_H
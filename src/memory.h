@@ -0,0 +1,230 @@
+#ifndef L1_MEMORY_H
+#define L1_MEMORY_H
+
+#include "AST.h"
+#include "reductions.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+struct MemoryStats {
+    std::array<std::int64_t, AST::NODE_TYPE_COUNT> liveNodes{};
+    std::uint64_t nodesCreated = 0;
+    std::uint64_t nodesDestroyed = 0;
+    /// Allocations of nodes and of the operand arrays of n-ary nodes
+    std::uint64_t allocations = 0;
+    std::uint64_t frees = 0;
+    std::uint64_t bytesAllocated = 0;
+    std::uint64_t bytesFreed = 0;
+    /// Bytes allocated minus bytes freed, plus the bytes adopted by MemoryAccount::adopt;
+    /// negative if more nodes were freed than allocated while recording.
+    std::int64_t liveBytes = 0;
+    /// Highest liveBytes seen while recording
+    std::int64_t peakLiveBytes = 0;
+    std::uint64_t reductionSteps = 0;
+
+    [[nodiscard]] std::int64_t live(AST::NodeType nodeType) const {
+        return liveNodes[static_cast<std::size_t>(nodeType)];
+    }
+
+    [[nodiscard]] double allocationsPerStep() const {
+        return reductionSteps == 0 ? 0.0 : static_cast<double>(allocations) / static_cast<double>(reductionSteps);
+    }
+};
+
+
+/// Records the node allocations of its thread while installed by a MemoryScope.
+/// Accounts installed by enclosing scopes receive the same events.
+class MemoryAccount : public AST::IAllocationObserver {
+    MemoryStats recorded;
+    AST::IAllocationObserver *parent = nullptr;
+
+    friend class MemoryScope;
+
+public:
+    [[nodiscard]] const MemoryStats &stats() const { return recorded; }
+
+    void reset() { recorded = {}; }
+
+    /// Counts the live nodes and bytes of a program allocated outside of the account, see footprint(),
+    /// e.g. the program a reducer starts with.
+    void adopt(const MemoryStats &program) {
+        for (std::size_t i = 0; i < AST::NODE_TYPE_COUNT; ++i) recorded.liveNodes[i] += program.liveNodes[i];
+        recorded.liveBytes += program.liveBytes;
+        recorded.peakLiveBytes = std::max(recorded.peakLiveBytes, recorded.liveBytes);
+    }
+
+    /// Stops counting a program as live without it being freed, e.g. the result a reducer hands back.
+    void release(const MemoryStats &program) {
+        for (std::size_t i = 0; i < AST::NODE_TYPE_COUNT; ++i) recorded.liveNodes[i] -= program.liveNodes[i];
+        recorded.liveBytes -= program.liveBytes;
+    }
+
+    void allocated(std::size_t bytes) override {
+        recorded.allocations++;
+        recorded.bytesAllocated += bytes;
+        recorded.liveBytes += static_cast<std::int64_t>(bytes);
+        recorded.peakLiveBytes = std::max(recorded.peakLiveBytes, recorded.liveBytes);
+        if (parent) parent->allocated(bytes);
+    }
+
+    void freed(std::size_t bytes) override {
+        recorded.frees++;
+        recorded.bytesFreed += bytes;
+        recorded.liveBytes -= static_cast<std::int64_t>(bytes);
+        if (parent) parent->freed(bytes);
+    }
+
+    void created(AST::NodeType nodeType) override {
+        recorded.nodesCreated++;
+        recorded.liveNodes[static_cast<std::size_t>(nodeType)]++;
+        if (parent) parent->created(nodeType);
+    }
+
+    void destroyed(AST::NodeType nodeType) override {
+        recorded.nodesDestroyed++;
+        recorded.liveNodes[static_cast<std::size_t>(nodeType)]--;
+        if (parent) parent->destroyed(nodeType);
+    }
+
+    void reductionStep() override {
+        recorded.reductionSteps++;
+        if (parent) parent->reductionStep();
+    }
+};
+
+
+/// Installs the account as the allocation observer of the current thread for the lifetime of the scope.
+class MemoryScope {
+    MemoryAccount &account;
+
+public:
+    explicit MemoryScope(MemoryAccount &account) : account(account) {
+        account.parent = AST::allocationObserver;
+        AST::allocationObserver = &account;
+    }
+
+    MemoryScope(const MemoryScope &) = delete;
+    MemoryScope &operator=(const MemoryScope &) = delete;
+
+    ~MemoryScope() {
+        AST::allocationObserver = account.parent;
+        account.parent = nullptr;
+    }
+};
+
+
+/// Size of the node object itself, excluding its children and the operand array of n-ary nodes.
+static std::size_t node_size(const AST::Node &node) {
+    switch (node.nodeType) {
+        case AST::NodeType::NUMBER_LITERAL:
+            return sizeof(AST::NumberNode);
+        case AST::NodeType::BOOLEAN_LITERAL:
+            return sizeof(AST::BooleanNode);
+        case AST::NodeType::ADD:
+            return sizeof(AST::AddNode);
+        case AST::NodeType::SUBTRACT:
+            return sizeof(AST::SubtractNode);
+        case AST::NodeType::LESS_THAN:
+            return sizeof(AST::LessThanNode);
+        case AST::NodeType::GREATER_THAN:
+            return sizeof(AST::GreaterThanNode);
+        case AST::NodeType::AND:
+            return sizeof(AST::AndNode);
+        case AST::NodeType::OR:
+            return sizeof(AST::OrNode);
+        case AST::NodeType::IF:
+            return sizeof(AST::IfNode);
+        case AST::NodeType::PARAMETER:
+            return sizeof(AST::ParameterNode);
+        case AST::NodeType::SUM:
+            return sizeof(AST::SumNode);
+        case AST::NodeType::ALL:
+            return sizeof(AST::AllNode);
+        case AST::NodeType::ANY:
+            return sizeof(AST::AnyNode);
+    }
+    return sizeof(AST::Node);
+}
+
+/// Size of the operand array of n-ary nodes, which is allocated separately from the node; 0 for other nodes.
+static std::size_t operand_buffer_size(const AST::Node &node) {
+    std::size_t capacity = 0;
+    if (auto *naryOp = node.as<AST::SumNode>()) capacity = naryOp->operands.capacity();
+    if (auto *naryOp = node.as<AST::AllNode>()) capacity = naryOp->operands.capacity();
+    if (auto *naryOp = node.as<AST::AnyNode>()) capacity = naryOp->operands.capacity();
+    return capacity * sizeof(AST::Node::Ptr);
+}
+
+/// The node counts and bytes a program currently occupies, as if all of it had been allocated in one scope.
+static MemoryStats footprint(const AST::Node &tree) {
+    MemoryStats stats;
+    auto allocate = [&](std::size_t bytes) {
+        stats.allocations++;
+        stats.bytesAllocated += bytes;
+        stats.liveBytes += static_cast<std::int64_t>(bytes);
+    };
+    auto visit = [&](const AST::Node &node, auto &visit) -> void {
+        stats.liveNodes[static_cast<std::size_t>(node.nodeType)]++;
+        stats.nodesCreated++;
+        allocate(node_size(node));
+        if (std::size_t operandBytes = operand_buffer_size(node)) allocate(operandBytes);
+        AST::for_each_child(node, [&](const AST::Node::Ptr &child) { visit(*child, visit); });
+    };
+    visit(tree, visit);
+    stats.peakLiveBytes = stats.liveBytes;
+    return stats;
+}
+
+
+/// Wraps another strategy and records the allocations of every reduction it performs.
+/// The program counts as live from the start of each reduction until its result is returned,
+/// so peakLiveBytes is the most memory the program occupied while being reduced.
+/// Not thread-safe: use one instance per thread.
+class AccountingReducer : public IReducerStrategy {
+    const IReducerStrategy &reducer;
+    mutable MemoryAccount memoryAccount;
+
+public:
+    explicit AccountingReducer(const IReducerStrategy &reducer) : reducer(reducer) {}
+
+    void reduce(AST::Node::Ptr &node) const override {
+        memoryAccount.adopt(footprint(*node));
+        {
+            MemoryScope scope(memoryAccount);
+            reducer.reduce(node);
+        }
+        memoryAccount.release(footprint(*node));
+    }
+
+    [[nodiscard]] const MemoryAccount &account() const { return memoryAccount; }
+
+    void reset() { memoryAccount.reset(); }
+};
+
+
+/// Upper limits for MemoryStats, meant for asserting that hot paths do not regress.
+struct MemoryBudget {
+    std::uint64_t maxAllocations = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t maxBytesAllocated = std::numeric_limits<std::uint64_t>::max();
+    std::int64_t maxPeakLiveBytes = std::numeric_limits<std::int64_t>::max();
+    double maxAllocationsPerStep = std::numeric_limits<double>::infinity();
+
+    /// Describes every exceeded limit, or returns an empty string if the stats are within budget.
+    [[nodiscard]] std::string violations(const MemoryStats &stats) const {
+        std::string result;
+        auto check = [&](const char *name, auto actual, auto limit) {
+            if (actual <= limit) return;
+            result += std::string(name) + " " + std::to_string(actual) + " exceeds " + std::to_string(limit) + "\n";
+        };
+        check("allocations", stats.allocations, maxAllocations);
+        check("bytesAllocated", stats.bytesAllocated, maxBytesAllocated);
+        check("peakLiveBytes", stats.peakLiveBytes, maxPeakLiveBytes);
+        check("allocationsPerStep", stats.allocationsPerStep(), maxAllocationsPerStep);
+        return result;
+    }
+};
+
+#endif//L1_MEMORY_H
@@ -0,0 +1,57 @@
+#ifndef L1_NORMALIZE_H
+#define L1_NORMALIZE_H
+
+#include "AST.h"
+#include <vector>
+
+/// Moves the operands of a chain of `binaryType` (or already flattened `naryType`) nodes into `operands`,
+/// from left to right. Chains are walked with an explicit stack, so long spines do not recurse.
+template<AST::NodeType binaryType, AST::NodeType naryType>
+static void collect_chain(AST::Node::Ptr chain, AST::Operands &operands) {
+    std::vector<AST::Node::Ptr> pending;
+    pending.push_back(std::move(chain));
+
+    while (!pending.empty()) {
+        AST::Node::Ptr node = std::move(pending.back());
+        pending.pop_back();
+
+        if (auto *binaryOp = node->as<AST::BinaryOpBase<binaryType>>()) {
+            pending.push_back(std::move(binaryOp->right));
+            pending.push_back(std::move(binaryOp->left));
+        } else if (auto *naryOp = node->as<AST::NaryOpBase<naryType>>()) {
+            for (auto operand = naryOp->operands.rbegin(); operand != naryOp->operands.rend(); ++operand) {
+                pending.push_back(std::move(*operand));
+            }
+        } else {
+            operands.push_back(std::move(node));
+        }
+    }
+}
+
+/// Replaces chains of at least two nested Add, And or Or nodes by a single Sum, All or Any node.
+/// Single binary operations are kept, as they are already as cheap as they get.
+static void normalize_associative(AST::Node::Ptr &node) {
+    auto isChain = [](AST::Node &node, AST::NodeType binaryType, AST::NodeType naryType) {
+        bool chained = false;
+        AST::for_each_child(node, [&](AST::Node::Ptr &child) {
+            chained |= child->nodeType == binaryType || child->nodeType == naryType;
+        });
+        return node.nodeType == naryType || (node.nodeType == binaryType && chained);
+    };
+
+    AST::Operands operands;
+    if (isChain(*node, AST::NodeType::ADD, AST::NodeType::SUM)) {
+        collect_chain<AST::NodeType::ADD, AST::NodeType::SUM>(std::move(node), operands);
+        node = AST::Sum(std::move(operands));
+    } else if (isChain(*node, AST::NodeType::AND, AST::NodeType::ALL)) {
+        collect_chain<AST::NodeType::AND, AST::NodeType::ALL>(std::move(node), operands);
+        node = AST::All(std::move(operands));
+    } else if (isChain(*node, AST::NodeType::OR, AST::NodeType::ANY)) {
+        collect_chain<AST::NodeType::OR, AST::NodeType::ANY>(std::move(node), operands);
+        node = AST::Any(std::move(operands));
+    }
+
+    AST::for_each_child(*node, [](AST::Node::Ptr &child) { normalize_associative(child); });
+}
+
+#endif//L1_NORMALIZE_H
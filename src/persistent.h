@@ -0,0 +1,268 @@
+#ifndef L1_PERSISTENT_H
+#define L1_PERSISTENT_H
+
+#include "AST.h"
+#include "reductions.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/// Immutable, reference-counted variant of the AST. Reducing a program creates new nodes only on the path
+/// from the root to the reduced subtree and shares everything else with the previous version,
+/// so keeping a snapshot of a program is a pointer copy.
+namespace Persistent {
+    struct Node;
+    using Ptr = std::shared_ptr<const Node>;
+
+    /// Most children of a node. The operands of wider Sum, All and Any nodes are split into nested groups
+    /// of the same operation, which is associative, so that a step copies at most GROUP_SIZE pointers per node.
+    constexpr std::size_t GROUP_SIZE = 32;
+
+    struct Node {
+        AST::NodeType nodeType;
+        /// The value of literals (booleans as 0 or 1) and the slot of parameters
+        int value = 0;
+        /// In the order of AST::for_each_child
+        std::vector<Ptr> children;
+        /// Operand group of the enclosing n-ary node, merged back into it by to_ast
+        bool group = false;
+
+        [[nodiscard]] bool isLiteral() const {
+            return nodeType == AST::NodeType::NUMBER_LITERAL || nodeType == AST::NodeType::BOOLEAN_LITERAL;
+        }
+    };
+
+    static Ptr Number(int n) {
+        return std::make_shared<const Node>(Node{AST::NodeType::NUMBER_LITERAL, n, {}, false});
+    }
+
+    static Ptr Boolean(bool b) {
+        return std::make_shared<const Node>(Node{AST::NodeType::BOOLEAN_LITERAL, b, {}, false});
+    }
+
+    static std::optional<AST::Value> literal_value(const Node &node) {
+        if (node.nodeType == AST::NodeType::NUMBER_LITERAL) return node.value;
+        if (node.nodeType == AST::NodeType::BOOLEAN_LITERAL) return node.value != 0;
+        return std::nullopt;
+    }
+
+    static bool is_nary(AST::NodeType nodeType) {
+        return nodeType == AST::NodeType::SUM || nodeType == AST::NodeType::ALL || nodeType == AST::NodeType::ANY;
+    }
+
+    /// Splits the operands into groups of at most GROUP_SIZE, and those again, until at most GROUP_SIZE are left.
+    static std::vector<Ptr> group_operands(AST::NodeType nodeType, std::vector<Ptr> operands) {
+        while (operands.size() > GROUP_SIZE) {
+            std::vector<Ptr> groups;
+            for (std::size_t begin = 0; begin < operands.size(); begin += GROUP_SIZE) {
+                auto first = operands.begin() + static_cast<std::ptrdiff_t>(begin);
+                auto last = operands.begin() + static_cast<std::ptrdiff_t>(std::min(begin + GROUP_SIZE, operands.size()));
+                Node group{nodeType, 0, {std::make_move_iterator(first), std::make_move_iterator(last)}, true};
+                groups.push_back(std::make_shared<const Node>(std::move(group)));
+            }
+            operands = std::move(groups);
+        }
+        return operands;
+    }
+
+    static Ptr from_ast(const AST::Node &tree) {
+        Node node{tree.nodeType, 0, {}, false};
+        if (auto *number = tree.as<AST::NumberNode>()) node.value = number->value;
+        if (auto *boolean = tree.as<AST::BooleanNode>()) node.value = boolean->value;
+        if (auto *parameter = tree.as<AST::ParameterNode>()) node.value = static_cast<int>(parameter->slot);
+        AST::for_each_child(tree, [&](const AST::Node::Ptr &child) { node.children.push_back(from_ast(*child)); });
+        if (is_nary(node.nodeType)) node.children = group_operands(node.nodeType, std::move(node.children));
+        return std::make_shared<const Node>(std::move(node));
+    }
+
+    static AST::Node::Ptr to_ast(const Node &node);
+
+    /// Converts the operands of an n-ary node, flattening the groups made by group_operands.
+    static void collect_operands(const Node &node, AST::Operands &operands) {
+        for (const Ptr &child: node.children) {
+            if (child->group) collect_operands(*child, operands);
+            else operands.push_back(to_ast(*child));
+        }
+    }
+
+    /// Builds a mutable copy of the program, e.g. to hand a snapshot to an IReducerStrategy.
+    static AST::Node::Ptr to_ast(const Node &node) {
+        AST::Operands children;
+        if (is_nary(node.nodeType)) {
+            collect_operands(node, children);
+        } else {
+            for (const Ptr &child: node.children) children.push_back(to_ast(*child));
+        }
+
+        switch (node.nodeType) {
+            case AST::NodeType::NUMBER_LITERAL:
+                return AST::Number(node.value);
+            case AST::NodeType::BOOLEAN_LITERAL:
+                return AST::Boolean(node.value != 0);
+            case AST::NodeType::PARAMETER:
+                return AST::Parameter(static_cast<std::size_t>(node.value));
+            case AST::NodeType::ADD:
+                return AST::Add(std::move(children[0]), std::move(children[1]));
+            case AST::NodeType::SUBTRACT:
+                return AST::Subtract(std::move(children[0]), std::move(children[1]));
+            case AST::NodeType::LESS_THAN:
+                return AST::LessThan(std::move(children[0]), std::move(children[1]));
+            case AST::NodeType::GREATER_THAN:
+                return AST::GraterThan(std::move(children[0]), std::move(children[1]));
+            case AST::NodeType::AND:
+                return AST::And(std::move(children[0]), std::move(children[1]));
+            case AST::NodeType::OR:
+                return AST::Or(std::move(children[0]), std::move(children[1]));
+            case AST::NodeType::IF:
+                return AST::If(std::move(children[0]), std::move(children[1]), std::move(children[2]));
+            case AST::NodeType::SUM:
+                return AST::Sum(std::move(children));
+            case AST::NodeType::ALL:
+                return AST::All(std::move(children));
+            case AST::NodeType::ANY:
+                return AST::Any(std::move(children));
+        }
+        return nullptr;
+    }
+
+    /// Copies the node with one child replaced, sharing all other children. Copies at most GROUP_SIZE pointers.
+    static Ptr with_child(const Node &node, std::size_t index, Ptr child) {
+        Node copy = node;
+        copy.children[index] = std::move(child);
+        return std::make_shared<const Node>(std::move(copy));
+    }
+
+    /// Value of an operation whose operands are all literals, or nothing if the operands are ill-typed.
+    static Ptr apply(const Node &node) {
+        auto numbers = [&] {
+            return node.children[0]->nodeType == AST::NodeType::NUMBER_LITERAL &&
+                   node.children[1]->nodeType == AST::NodeType::NUMBER_LITERAL;
+        };
+        auto booleans = [&] {
+            return node.children[0]->nodeType == AST::NodeType::BOOLEAN_LITERAL &&
+                   node.children[1]->nodeType == AST::NodeType::BOOLEAN_LITERAL;
+        };
+
+        switch (node.nodeType) {
+            case AST::NodeType::ADD:
+                if (numbers()) return Number(node.children[0]->value + node.children[1]->value);
+                break;
+            case AST::NodeType::SUBTRACT:
+                if (numbers()) return Number(node.children[0]->value - node.children[1]->value);
+                break;
+            case AST::NodeType::LESS_THAN:
+                if (numbers()) return Boolean(node.children[0]->value < node.children[1]->value);
+                break;
+            case AST::NodeType::GREATER_THAN:
+                if (numbers()) return Boolean(node.children[0]->value > node.children[1]->value);
+                break;
+            case AST::NodeType::AND:
+                if (booleans()) return Boolean(node.children[0]->value && node.children[1]->value);
+                break;
+            case AST::NodeType::OR:
+                if (booleans()) return Boolean(node.children[0]->value || node.children[1]->value);
+                break;
+            case AST::NodeType::SUM: {
+                std::vector<int> numbers;
+                numbers.reserve(node.children.size());
+                for (const Ptr &operand: node.children) {
+                    if (operand->nodeType != AST::NodeType::NUMBER_LITERAL) return nullptr;
+                    numbers.push_back(operand->value);
+                }
+                return Number(simd_sum(numbers));
+            }
+            default:
+                break;
+        }
+        return nullptr;
+    }
+
+    /// Performs the next reduction step and returns the new root, or nullptr if the program is irreducible.
+    /// Operands are reduced from left to right, like the rule-based reducers do.
+    static Ptr reduce_step(const Ptr &node) {
+        switch (node->nodeType) {
+            case AST::NodeType::NUMBER_LITERAL:
+            case AST::NodeType::BOOLEAN_LITERAL:
+            case AST::NodeType::PARAMETER:
+                return nullptr;
+            case AST::NodeType::IF: {
+                const Ptr &condition = node->children[0];
+                if (condition->nodeType == AST::NodeType::BOOLEAN_LITERAL) {
+                    return condition->value ? node->children[1] : node->children[2];
+                }
+                Ptr reduced = reduce_step(condition);
+                return reduced ? with_child(*node, 0, std::move(reduced)) : nullptr;
+            }
+            case AST::NodeType::ALL:
+            case AST::NodeType::ANY: {
+                // stop at the first operand deciding the result
+                bool stopAt = node->nodeType == AST::NodeType::ANY;
+                for (std::size_t i = 0; i < node->children.size(); ++i) {
+                    const Ptr &operand = node->children[i];
+                    if (operand->nodeType != AST::NodeType::BOOLEAN_LITERAL) {
+                        Ptr reduced = reduce_step(operand);
+                        return reduced ? with_child(*node, i, std::move(reduced)) : nullptr;
+                    }
+                    if ((operand->value != 0) == stopAt) return Boolean(stopAt);
+                }
+                return Boolean(!stopAt);
+            }
+            default: {
+                for (std::size_t i = 0; i < node->children.size(); ++i) {
+                    if (node->children[i]->isLiteral()) continue;
+                    Ptr reduced = reduce_step(node->children[i]);
+                    return reduced ? with_child(*node, i, std::move(reduced)) : nullptr;
+                }
+                return apply(*node);
+            }
+        }
+    }
+
+    /// Reduces the program as much as possible, with the same result as repeating reduce_step.
+    /// Every subtree is reduced at most once, bottom-up, instead of searching for the next step from the root.
+    /// Subtrees that do not change are shared with the program passed in, which is left unchanged.
+    static Ptr reduce(const Ptr &node) {
+        switch (node->nodeType) {
+            case AST::NodeType::NUMBER_LITERAL:
+            case AST::NodeType::BOOLEAN_LITERAL:
+            case AST::NodeType::PARAMETER:
+                return node;
+            case AST::NodeType::IF: {
+                Ptr condition = reduce(node->children[0]);
+                if (condition->nodeType == AST::NodeType::BOOLEAN_LITERAL) {
+                    return reduce(condition->value ? node->children[1] : node->children[2]);
+                }
+                return condition == node->children[0] ? node : with_child(*node, 0, std::move(condition));
+            }
+            default:
+                break;
+        }
+
+        // the operands are reduced from left to right, and the first one left irreducible stops the reduction
+        bool shortCircuit = node->nodeType == AST::NodeType::ALL || node->nodeType == AST::NodeType::ANY;
+        bool stopAt = node->nodeType == AST::NodeType::ANY;
+        std::optional<Node> copy;
+        for (std::size_t i = 0; i < node->children.size(); ++i) {
+            Ptr operand = reduce(node->children[i]);
+            if (shortCircuit && operand->nodeType == AST::NodeType::BOOLEAN_LITERAL && (operand->value != 0) == stopAt) {
+                return Boolean(stopAt);
+            }
+
+            bool irreducible = shortCircuit ? operand->nodeType != AST::NodeType::BOOLEAN_LITERAL : !operand->isLiteral();
+            if (operand != node->children[i]) {
+                if (!copy) copy = *node;
+                copy->children[i] = std::move(operand);
+            }
+            if (irreducible) return copy ? std::make_shared<const Node>(std::move(*copy)) : node;
+        }
+
+        if (shortCircuit) return Boolean(!stopAt);
+        const Node &operands = copy ? *copy : *node;
+        if (Ptr result = apply(operands)) return result;
+        return copy ? std::make_shared<const Node>(std::move(*copy)) : node;
+    }
+}// namespace Persistent
+
+#endif//L1_PERSISTENT_H
@@ -0,0 +1,243 @@
+#ifndef L1_PREPARED_H
+#define L1_PREPARED_H
+
+#include "AST.h"
+#include "types.h"
+#include <algorithm>
+#include <cassert>
+#include <optional>
+#include <span>
+#include <vector>
+
+/// A type-checked program with parameters, compiled once into a flat instruction list
+/// so that it can be evaluated for many input bindings without building or reducing trees.
+class PreparedProgram {
+public:
+    enum class OpCode {
+        PUSH,
+        LOAD,
+        ADD,
+        SUBTRACT,
+        LESS_THAN,
+        GREATER_THAN,
+        AND,
+        OR,
+        JUMP_IF_FALSE,
+        JUMP
+    };
+
+    struct Instruction {
+        OpCode opCode;
+        /// The literal for PUSH, the slot for LOAD and the target instruction for jumps.
+        int operand = 0;
+    };
+
+    /// Type checks the program with the declared parameter types and compiles it.
+    /// Returns nothing if the program is ill-typed. Types inferred by earlier preparations are discarded.
+    static std::optional<PreparedProgram> prepare(AST::Node &program, std::vector<AST::ValueType> parameterTypes) {
+        reset_types(program);
+        init_types(program, parameterTypes);
+        if (program.type == AST::ValueType::UNKNOWN) return std::nullopt;
+
+        PreparedProgram prepared;
+        prepared.resultType = program.type;
+        prepared.parameterTypes = std::move(parameterTypes);
+        int depth = 0;
+        prepared.compile(program, depth);
+        return prepared;
+    }
+
+    [[nodiscard]] AST::ValueType type() const { return resultType; }
+
+    [[nodiscard]] std::span<const AST::ValueType> parameters() const { return parameterTypes; }
+
+    [[nodiscard]] std::span<const Instruction> instructions() const { return code; }
+
+    /// Evaluates the program with arguments[slot] bound to each parameter.
+    /// The arguments have to match the declared parameter types.
+    [[nodiscard]] AST::Value evaluate(std::span<const AST::Value> arguments) const {
+        assert(arguments.size() >= parameterTypes.size());
+        return run([&](std::size_t slot) {
+            const AST::Value &argument = arguments[slot];
+            assert(std::holds_alternative<int>(argument) == (parameterTypes[slot] == AST::ValueType::NUMBER));
+            return std::visit([](auto value) { return static_cast<int>(value); }, argument);
+        });
+    }
+
+    /// Evaluates the program once per row, with columns[slot][row] bound to each parameter.
+    /// Booleans are passed as 0 or 1; every column has to have at least `rows` elements.
+    [[nodiscard]] std::vector<AST::Value> evaluate(std::span<const std::span<const int>> columns, std::size_t rows) const {
+        assert(columns.size() >= parameterTypes.size());
+        std::vector<AST::Value> results;
+        results.reserve(rows);
+        for (std::size_t row = 0; row < rows; ++row) {
+            results.push_back(run([&](std::size_t slot) { return columns[slot][row]; }));
+        }
+        return results;
+    }
+
+private:
+    std::vector<Instruction> code;
+    std::vector<AST::ValueType> parameterTypes;
+    AST::ValueType resultType = AST::ValueType::UNKNOWN;
+    std::size_t maxStackDepth = 0;
+
+    PreparedProgram() = default;
+
+    void emit(OpCode opCode, int operand = 0) {
+        code.push_back({opCode, operand});
+    }
+
+    void compileBinary(OpCode opCode, AST::Node &left, AST::Node &right, int &depth) {
+        compile(left, depth);
+        compile(right, depth);
+        emit(opCode);
+        depth--;
+    }
+
+    template<class NaryNode>
+    void compileNary(OpCode opCode, int identity, NaryNode &naryOp, int &depth) {
+        if (naryOp.operands.empty()) {
+            emit(OpCode::PUSH, identity);
+            depth++;
+            return;
+        }
+        compile(*naryOp.operands.front(), depth);
+        for (std::size_t i = 1; i < naryOp.operands.size(); ++i) {
+            compile(*naryOp.operands[i], depth);
+            emit(opCode);
+            depth--;
+        }
+    }
+
+    /// Appends the instructions leaving the value of the node on top of the stack.
+    void compile(AST::Node &node, int &depth) {
+        switch (node.nodeType) {
+            case AST::NodeType::NUMBER_LITERAL:
+                emit(OpCode::PUSH, node.as<AST::NumberNode>()->value);
+                depth++;
+                break;
+            case AST::NodeType::BOOLEAN_LITERAL:
+                emit(OpCode::PUSH, node.as<AST::BooleanNode>()->value);
+                depth++;
+                break;
+            case AST::NodeType::PARAMETER:
+                emit(OpCode::LOAD, static_cast<int>(node.as<AST::ParameterNode>()->slot));
+                depth++;
+                break;
+            case AST::NodeType::ADD: {
+                auto binaryOp = node.as<AST::AddNode>();
+                compileBinary(OpCode::ADD, *binaryOp->left, *binaryOp->right, depth);
+                break;
+            }
+            case AST::NodeType::SUBTRACT: {
+                auto binaryOp = node.as<AST::SubtractNode>();
+                compileBinary(OpCode::SUBTRACT, *binaryOp->left, *binaryOp->right, depth);
+                break;
+            }
+            case AST::NodeType::LESS_THAN: {
+                auto binaryOp = node.as<AST::LessThanNode>();
+                compileBinary(OpCode::LESS_THAN, *binaryOp->left, *binaryOp->right, depth);
+                break;
+            }
+            case AST::NodeType::GREATER_THAN: {
+                auto binaryOp = node.as<AST::GreaterThanNode>();
+                compileBinary(OpCode::GREATER_THAN, *binaryOp->left, *binaryOp->right, depth);
+                break;
+            }
+            case AST::NodeType::AND: {
+                auto binaryOp = node.as<AST::AndNode>();
+                compileBinary(OpCode::AND, *binaryOp->left, *binaryOp->right, depth);
+                break;
+            }
+            case AST::NodeType::OR: {
+                auto binaryOp = node.as<AST::OrNode>();
+                compileBinary(OpCode::OR, *binaryOp->left, *binaryOp->right, depth);
+                break;
+            }
+            case AST::NodeType::IF: {
+                // Only the selected branch is evaluated, like IfResultReduction discards the other one
+                auto ternaryIf = node.as<AST::IfNode>();
+                compile(*ternaryIf->condition, depth);
+                std::size_t jumpToFalse = code.size();
+                emit(OpCode::JUMP_IF_FALSE);
+                depth--;
+
+                compile(*ternaryIf->whenTrue, depth);
+                std::size_t jumpToEnd = code.size();
+                emit(OpCode::JUMP);
+                depth--;
+
+                code[jumpToFalse].operand = static_cast<int>(code.size());
+                compile(*ternaryIf->whenFalse, depth);
+                code[jumpToEnd].operand = static_cast<int>(code.size());
+                break;
+            }
+            case AST::NodeType::SUM:
+                compileNary(OpCode::ADD, 0, *node.as<AST::SumNode>(), depth);
+                break;
+            case AST::NodeType::ALL:
+                compileNary(OpCode::AND, true, *node.as<AST::AllNode>(), depth);
+                break;
+            case AST::NodeType::ANY:
+                compileNary(OpCode::OR, false, *node.as<AST::AnyNode>(), depth);
+                break;
+        }
+        maxStackDepth = std::max(maxStackDepth, static_cast<std::size_t>(depth));
+    }
+
+    template<class Load>
+    AST::Value run(Load &&load) const {
+        // Reused between calls, so that evaluation does not allocate once the stack has grown
+        thread_local std::vector<int> stack;
+        if (stack.size() < maxStackDepth) stack.resize(maxStackDepth);
+
+        int *top = stack.data();
+        for (std::size_t pc = 0; pc < code.size(); ++pc) {
+            const Instruction &instruction = code[pc];
+            switch (instruction.opCode) {
+                case OpCode::PUSH:
+                    *top++ = instruction.operand;
+                    break;
+                case OpCode::LOAD:
+                    *top++ = load(static_cast<std::size_t>(instruction.operand));
+                    break;
+                case OpCode::ADD:
+                    top--;
+                    top[-1] = top[-1] + top[0];
+                    break;
+                case OpCode::SUBTRACT:
+                    top--;
+                    top[-1] = top[-1] - top[0];
+                    break;
+                case OpCode::LESS_THAN:
+                    top--;
+                    top[-1] = top[-1] < top[0];
+                    break;
+                case OpCode::GREATER_THAN:
+                    top--;
+                    top[-1] = top[-1] > top[0];
+                    break;
+                case OpCode::AND:
+                    top--;
+                    top[-1] = top[-1] && top[0];
+                    break;
+                case OpCode::OR:
+                    top--;
+                    top[-1] = top[-1] || top[0];
+                    break;
+                case OpCode::JUMP_IF_FALSE:
+                    if (!*--top) pc = instruction.operand - 1;
+                    break;
+                case OpCode::JUMP:
+                    pc = instruction.operand - 1;
+                    break;
+            }
+        }
+
+        if (resultType == AST::ValueType::BOOLEAN) return static_cast<bool>(top[-1]);
+        return top[-1];
+    }
+};
+
+#endif//L1_PREPARED_H
@@ -0,0 +1,217 @@
+#ifndef L1_RECLAIM_H
+#define L1_RECLAIM_H
+
+#include "AST.h"
+#include "reductions.h"
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Collects the subtrees discarded by reductions instead of destroying them inside the reduction step.
+///
+/// In BATCHED mode they are destroyed together by flush(), on the calling thread.
+/// In BACKGROUND mode a reclaimer thread destroys them as they arrive; flush() waits until it caught up.
+/// Frees made by the background thread are not seen by the MemoryAccount of the reducing thread.
+class DeferredReclaimer : public IReclaimer {
+public:
+    enum class Mode {
+        BATCHED,
+        BACKGROUND
+    };
+
+    explicit DeferredReclaimer(Mode mode) : mode(mode) {
+        if (mode == Mode::BACKGROUND) worker = std::thread([this] { reclaimLoop(); });
+    }
+
+    DeferredReclaimer(const DeferredReclaimer &) = delete;
+    DeferredReclaimer &operator=(const DeferredReclaimer &) = delete;
+
+    ~DeferredReclaimer() override {
+        if (worker.joinable()) {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            wakeWorker.notify_one();
+            worker.join();
+        }
+        // subtrees still pending in BATCHED mode are destroyed with the vector
+    }
+
+    void discard(AST::Node::Ptr subtree) override {
+        {
+            std::lock_guard lock(mutex);
+            pending.push_back(std::move(subtree));
+            discarded++;
+        }
+        if (mode == Mode::BACKGROUND) wakeWorker.notify_one();
+    }
+
+    /// Takes all the subtrees at once, with a single lock and wake-up. Leaves `subtrees` empty.
+    void discardBatch(std::vector<AST::Node::Ptr> &subtrees) {
+        if (subtrees.empty()) return;
+        {
+            std::lock_guard lock(mutex);
+            discarded += subtrees.size();
+            if (pending.empty()) {
+                pending.swap(subtrees);
+            } else {
+                pending.insert(pending.end(), std::make_move_iterator(subtrees.begin()), std::make_move_iterator(subtrees.end()));
+            }
+        }
+        subtrees.clear();
+        if (mode == Mode::BACKGROUND) wakeWorker.notify_one();
+    }
+
+    /// Returns once every subtree discarded so far has been destroyed.
+    void flush() {
+        if (mode == Mode::BATCHED) {
+            std::vector<AST::Node::Ptr> batch;
+            {
+                std::lock_guard lock(mutex);
+                batch.swap(pending);
+                reclaimed += batch.size();
+            }
+            return;
+        }
+
+        std::unique_lock lock(mutex);
+        caughtUp.wait(lock, [&] { return pending.empty() && !reclaiming; });
+    }
+
+    [[nodiscard]] Mode reclaimMode() const { return mode; }
+
+    /// Number of subtrees received, and number of them destroyed so far.
+    [[nodiscard]] std::uint64_t discardedCount() const {
+        std::lock_guard lock(mutex);
+        return discarded;
+    }
+
+    [[nodiscard]] std::uint64_t reclaimedCount() const {
+        std::lock_guard lock(mutex);
+        return reclaimed;
+    }
+
+private:
+    const Mode mode;
+    mutable std::mutex mutex;
+    std::condition_variable wakeWorker;
+    std::condition_variable caughtUp;
+    std::vector<AST::Node::Ptr> pending;
+    std::uint64_t discarded = 0;
+    std::uint64_t reclaimed = 0;
+    bool reclaiming = false;
+    bool stopping = false;
+    std::thread worker;
+
+    void reclaimLoop() {
+        std::vector<AST::Node::Ptr> batch;
+        std::unique_lock lock(mutex);
+        while (true) {
+            wakeWorker.wait(lock, [&] { return stopping || !pending.empty(); });
+            if (pending.empty() && stopping) break;
+
+            batch.swap(pending);
+            reclaiming = true;
+            lock.unlock();
+
+            std::size_t count = batch.size();
+            batch.clear();
+
+            lock.lock();
+            reclaiming = false;
+            reclaimed += count;
+            caughtUp.notify_all();
+        }
+    }
+};
+
+
+/// Installs the reclaimer for the discarded subtrees of the current thread for the lifetime of the scope.
+class ReclaimScope {
+    IReclaimer *previous;
+
+public:
+    explicit ReclaimScope(IReclaimer &reclaimer) : previous(activeReclaimer) {
+        activeReclaimer = &reclaimer;
+    }
+
+    ReclaimScope(const ReclaimScope &) = delete;
+    ReclaimScope &operator=(const ReclaimScope &) = delete;
+
+    ~ReclaimScope() {
+        activeReclaimer = previous;
+    }
+};
+
+
+/// Front end of a DeferredReclaimer for the reductions of one thread, so that reduction steps never lock.
+/// Subtrees of at most SMALL_SUBTREE_NODES nodes, like the operands of a reduced binary operation,
+/// are cheaper to free right away than to hand over, and are destroyed inline. The others, like the
+/// branch an If discards, are buffered and handed to the reclaimer in chunks, and when the buffer is destroyed.
+class ReclaimBuffer : public IReclaimer {
+public:
+    static constexpr std::size_t SMALL_SUBTREE_NODES = 4;
+    static constexpr std::size_t CHUNK_SIZE = 256;
+
+    explicit ReclaimBuffer(DeferredReclaimer &reclaimer) : reclaimer(reclaimer) {}
+
+    ReclaimBuffer(const ReclaimBuffer &) = delete;
+    ReclaimBuffer &operator=(const ReclaimBuffer &) = delete;
+
+    ~ReclaimBuffer() override {
+        reclaimer.discardBatch(buffered);
+    }
+
+    void discard(AST::Node::Ptr subtree) override {
+        std::size_t remaining = SMALL_SUBTREE_NODES;
+        if (fitsWithin(*subtree, remaining)) return;
+
+        buffered.push_back(std::move(subtree));
+        if (buffered.size() >= CHUNK_SIZE) reclaimer.discardBatch(buffered);
+    }
+
+private:
+    DeferredReclaimer &reclaimer;
+    std::vector<AST::Node::Ptr> buffered;
+
+    /// Whether the subtree has at most `remaining` nodes. Children moved out by the reduction are null.
+    static bool fitsWithin(const AST::Node &node, std::size_t &remaining) {
+        if (remaining == 0) return false;
+        remaining--;
+        bool fits = true;
+        AST::for_each_child(node, [&](const AST::Node::Ptr &child) {
+            fits = fits && (!child || fitsWithin(*child, remaining));
+        });
+        return fits;
+    }
+};
+
+
+/// Wraps another strategy so that its reduction steps hand discarded subtrees to the reclaimer,
+/// through a ReclaimBuffer. With a BATCHED reclaimer, everything handed over is released in bulk
+/// after the reduction returns, unless flushAfterReduce leaves it to the caller.
+/// A BACKGROUND reclaimer is never waited for.
+class ReclaimingReducer : public IReducerStrategy {
+    const IReducerStrategy &reducer;
+    DeferredReclaimer &reclaimer;
+    bool flushAfterReduce;
+
+public:
+    ReclaimingReducer(const IReducerStrategy &reducer, DeferredReclaimer &reclaimer, bool flushAfterReduce = true)
+        : reducer(reducer), reclaimer(reclaimer), flushAfterReduce(flushAfterReduce) {}
+
+    void reduce(AST::Node::Ptr &node) const override {
+        {
+            ReclaimBuffer buffer(reclaimer);
+            ReclaimScope scope(buffer);
+            reducer.reduce(node);
+        }
+        if (flushAfterReduce && reclaimer.reclaimMode() == DeferredReclaimer::Mode::BATCHED) reclaimer.flush();
+    }
+};
+
+#endif//L1_RECLAIM_H
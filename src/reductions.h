@@ -2,7 +2,12 @@
 #define L1_REDUCTIONS_H
 
 #include "AST.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <experimental/simd>
 #include <optional>
+#include <span>
 #include <vector>
 
 struct ReductionResult {
@@ -18,18 +23,83 @@ struct IReducerStrategy {
 };
 
 
+/// Lets the installed allocation observer attribute allocations to reduction steps.
+/// A step is one pass of a reducer's loop that changed the tree.
+static void record_reduction_step() {
+    if (AST::allocationObserver) AST::allocationObserver->reductionStep();
+}
+
+/// Receives the subtrees discarded by reductions while installed, see DeferredReclaimer in reclaim.h.
+struct IReclaimer {
+    virtual void discard(AST::Node::Ptr subtree) = 0;
+
+    virtual ~IReclaimer() = default;
+};
+
+inline thread_local IReclaimer *activeReclaimer = nullptr;
+
+/// Number of nodes replaced by reductions on this thread, so that rules can tell whether reducing a child changed it.
+inline thread_local std::uint64_t replacedNodes = 0;
+
+/// Replaces the node by the result of a reduction. The discarded node is destroyed right away,
+/// unless a reclaimer is installed on this thread.
+static void replace_node(AST::Node::Ptr &node, AST::Node::Ptr replacement) {
+    AST::Node::Ptr discarded = std::move(node);
+    node = std::move(replacement);
+    replacedNodes++;
+    if (activeReclaimer) activeReclaimer->discard(std::move(discarded));
+}
+
+/// Reduces the child and returns whether that changed it. Programs with parameters stay partially reduced,
+/// so rules reducing a child must not report progress when it was already as reduced as it gets.
+/// Rules replacing nodes without replace_node are still noticed when they replace the child itself.
+static bool reduce_child(const IReducerStrategy &reducer, AST::Node::Ptr &child) {
+    std::uint64_t before = replacedNodes;
+    const AST::Node *original = child.get();
+    reducer.reduce(child);
+    return replacedNodes != before || child.get() != original;
+}
+
+/// Necessary condition for a rule to apply: the kind of the node and the allowed kinds of its first two children.
+struct RulePattern {
+    using KindSet = std::uint32_t;
+    static_assert(AST::NODE_TYPE_COUNT <= 32, "KindSet has one bit per node type");
+
+    static constexpr KindSet ANY = ~KindSet{0};
+
+    static constexpr KindSet kind(AST::NodeType nodeType) {
+        return KindSet{1} << static_cast<unsigned>(nodeType);
+    }
+
+    static constexpr KindSet anyBut(AST::NodeType nodeType) {
+        return ANY & ~kind(nodeType);
+    }
+
+    AST::NodeType nodeType;
+    KindSet first = ANY;
+    KindSet second = ANY;
+};
+
 struct IReductionRule {
     using Ptr = std::unique_ptr<IReductionRule>;
 
     /// Returns whether the node has been reduced by this rule
     virtual bool reduce(AST::Node::Ptr &node) const = 0;
 
+    /// Nodes not matching the pattern are never reduced by this rule, so that RuleRegistry can skip it.
+    /// Rules without a pattern are tried on every node.
+    [[nodiscard]] virtual std::optional<RulePattern> pattern() const { return std::nullopt; }
+
     virtual ~IReductionRule() = default;
 };
 
 
 // BASIC REDUCTIONS
 struct AddSimpleReduction : public IReductionRule {
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::ADD, RulePattern::kind(AST::NodeType::NUMBER_LITERAL), RulePattern::kind(AST::NodeType::NUMBER_LITERAL)};
+    }
+
     bool reduce(AST::Node::Ptr &node) const override {
         auto *addNode = node->as<AST::AddNode>();
         bool match = addNode &&
@@ -37,13 +107,17 @@ struct AddSimpleReduction : public IReductionRule {
                      addNode->right->nodeType == AST::NodeType::NUMBER_LITERAL;
 
         if (!match) return false;
-        node = AST::Number(addNode->left->as<AST::NumberNode>()->value +
-                           addNode->right->as<AST::NumberNode>()->value);
+        replace_node(node, AST::Number(addNode->left->as<AST::NumberNode>()->value +
+                                       addNode->right->as<AST::NumberNode>()->value));
         return true;
     }
 };
 
 struct SubtractSimpleReduction : public IReductionRule {
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::SUBTRACT, RulePattern::kind(AST::NodeType::NUMBER_LITERAL), RulePattern::kind(AST::NodeType::NUMBER_LITERAL)};
+    }
+
     bool reduce(AST::Node::Ptr &node) const override {
         auto *subtractNode = node->as<AST::SubtractNode>();
         bool match = subtractNode &&
@@ -51,13 +125,17 @@ struct SubtractSimpleReduction : public IReductionRule {
                      subtractNode->right->nodeType == AST::NodeType::NUMBER_LITERAL;
 
         if (!match) return false;
-        node = AST::Number(subtractNode->left->as<AST::NumberNode>()->value -
-                           subtractNode->right->as<AST::NumberNode>()->value);
+        replace_node(node, AST::Number(subtractNode->left->as<AST::NumberNode>()->value -
+                                       subtractNode->right->as<AST::NumberNode>()->value));
         return true;
     }
 };
 
 struct LessThanSimpleReduction : public IReductionRule {
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::LESS_THAN, RulePattern::kind(AST::NodeType::NUMBER_LITERAL), RulePattern::kind(AST::NodeType::NUMBER_LITERAL)};
+    }
+
     bool reduce(AST::Node::Ptr &node) const override {
         auto *lessThanNode = node->as<AST::LessThanNode>();
         bool match = lessThanNode &&
@@ -65,13 +143,17 @@ struct LessThanSimpleReduction : public IReductionRule {
                      lessThanNode->right->nodeType == AST::NodeType::NUMBER_LITERAL;
 
         if (!match) return false;
-        node = AST::Boolean(lessThanNode->left->as<AST::NumberNode>()->value <
-                            lessThanNode->right->as<AST::NumberNode>()->value);
+        replace_node(node, AST::Boolean(lessThanNode->left->as<AST::NumberNode>()->value <
+                                        lessThanNode->right->as<AST::NumberNode>()->value));
         return true;
     }
 };
 
 struct GreaterThanSimpleReduction : public IReductionRule {
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::GREATER_THAN, RulePattern::kind(AST::NodeType::NUMBER_LITERAL), RulePattern::kind(AST::NodeType::NUMBER_LITERAL)};
+    }
+
     bool reduce(AST::Node::Ptr &node) const override {
         auto *greaterThanNode = node->as<AST::GreaterThanNode>();
         bool match = greaterThanNode &&
@@ -79,13 +161,17 @@ struct GreaterThanSimpleReduction : public IReductionRule {
                      greaterThanNode->right->nodeType == AST::NodeType::NUMBER_LITERAL;
 
         if (!match) return false;
-        node = AST::Boolean(greaterThanNode->left->as<AST::NumberNode>()->value >
-                            greaterThanNode->right->as<AST::NumberNode>()->value);
+        replace_node(node, AST::Boolean(greaterThanNode->left->as<AST::NumberNode>()->value >
+                                        greaterThanNode->right->as<AST::NumberNode>()->value));
         return true;
     }
 };
 
 struct AndSimpleReduction : public IReductionRule {
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::AND, RulePattern::kind(AST::NodeType::BOOLEAN_LITERAL), RulePattern::kind(AST::NodeType::BOOLEAN_LITERAL)};
+    }
+
     bool reduce(AST::Node::Ptr &node) const override {
         auto *andNode = node->as<AST::AndNode>();
         bool match = andNode &&
@@ -93,13 +179,17 @@ struct AndSimpleReduction : public IReductionRule {
                      andNode->right->nodeType == AST::NodeType::BOOLEAN_LITERAL;
 
         if (!match) return false;
-        node = AST::Boolean(andNode->left->as<AST::BooleanNode>()->value &&
-                            andNode->right->as<AST::BooleanNode>()->value);
+        replace_node(node, AST::Boolean(andNode->left->as<AST::BooleanNode>()->value &&
+                                        andNode->right->as<AST::BooleanNode>()->value));
         return true;
     }
 };
 
 struct OrSimpleReduction : public IReductionRule {
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::OR, RulePattern::kind(AST::NodeType::BOOLEAN_LITERAL), RulePattern::kind(AST::NodeType::BOOLEAN_LITERAL)};
+    }
+
     bool reduce(AST::Node::Ptr &node) const override {
         auto *orNode = node->as<AST::OrNode>();
         bool match = orNode &&
@@ -107,8 +197,8 @@ struct OrSimpleReduction : public IReductionRule {
                      orNode->right->nodeType == AST::NodeType::BOOLEAN_LITERAL;
 
         if (!match) return false;
-        node = AST::Boolean(orNode->left->as<AST::BooleanNode>()->value ||
-                            orNode->right->as<AST::BooleanNode>()->value);
+        replace_node(node, AST::Boolean(orNode->left->as<AST::BooleanNode>()->value ||
+                                        orNode->right->as<AST::BooleanNode>()->value));
         return true;
     }
 };
@@ -130,8 +220,11 @@ public:
         AST::Node::Ptr &leftChild = binaryNode->left;
         if (leftChild->nodeType == primitiveType) return false;
 
-        reducer.reduce(leftChild);
-        return true;
+        return reduce_child(reducer, leftChild);
+    }
+
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{nodeType, RulePattern::anyBut(primitiveType)};
     }
 
 protected:
@@ -174,8 +267,11 @@ public:
         bool match = binaryNode->left->nodeType == primitiveType && binaryNode->right->nodeType != primitiveType;
         if (!match) return false;
 
-        reducer.reduce(binaryNode->right);
-        return true;
+        return reduce_child(reducer, binaryNode->right);
+    }
+
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{nodeType, RulePattern::kind(primitiveType), RulePattern::anyBut(primitiveType)};
     }
 
 protected:
@@ -197,10 +293,10 @@ struct GreaterThanRightReduction
         : public RightReductionForBinaryOp<AST::NodeType::GREATER_THAN, AST::NodeType::NUMBER_LITERAL> {
     using RightReductionForBinaryOp_t::RightReductionForBinaryOp;
 };
-struct OrRightReduction : public RightReductionForBinaryOp<AST::NodeType::OR, AST::NodeType::NUMBER_LITERAL> {
+struct OrRightReduction : public RightReductionForBinaryOp<AST::NodeType::OR, AST::NodeType::BOOLEAN_LITERAL> {
     using RightReductionForBinaryOp_t::RightReductionForBinaryOp;
 };
-struct AndRightReduction : public RightReductionForBinaryOp<AST::NodeType::AND, AST::NodeType::NUMBER_LITERAL> {
+struct AndRightReduction : public RightReductionForBinaryOp<AST::NodeType::AND, AST::NodeType::BOOLEAN_LITERAL> {
     using RightReductionForBinaryOp_t::RightReductionForBinaryOp;
 };
 
@@ -216,64 +312,330 @@ public:
         bool match = ifNode && ifNode->condition->nodeType != AST::NodeType::BOOLEAN_LITERAL;
         if (!match) return false;
 
-        reducer.reduce(ifNode->condition);
-        return true;
+        return reduce_child(reducer, ifNode->condition);
+    }
+
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::IF, RulePattern::anyBut(AST::NodeType::BOOLEAN_LITERAL)};
     }
 };
 
 struct IfResultReduction : public IReductionRule {
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::IF, RulePattern::kind(AST::NodeType::BOOLEAN_LITERAL)};
+    }
+
     bool reduce(AST::Node::Ptr &node) const override {
         auto *ifNode = node->as<AST::IfNode>();
 
         bool match = ifNode && ifNode->condition->nodeType == AST::NodeType::BOOLEAN_LITERAL;
         if (!match) return false;
 
-        node = ifNode->condition->as<AST::BooleanNode>()->value ? std::move(ifNode->whenTrue) : std::move(
-                ifNode->whenFalse);
+        replace_node(node, ifNode->condition->as<AST::BooleanNode>()->value ? std::move(ifNode->whenTrue) : std::move(
+                ifNode->whenFalse));
+        return true;
+    }
+};
+
+
+// N-ARY REDUCTIONS
+/// Adds the numbers using the widest SIMD registers of the target, with a horizontal reduction at the end.
+static int simd_sum(std::span<const int> numbers) {
+    namespace stdx = std::experimental;
+    using Vector = stdx::native_simd<int>;
+
+    Vector partialSums = 0;
+    std::size_t i = 0;
+    for (; i + Vector::size() <= numbers.size(); i += Vector::size()) {
+        partialSums += Vector(numbers.data() + i, stdx::element_aligned);
+    }
+
+    int sum = stdx::reduce(partialSums);
+    for (; i < numbers.size(); ++i) sum += numbers[i];
+    return sum;
+}
+
+/// Reduces every operand, then folds all of them at once.
+struct SumReduction : public IReductionRule {
+    const IReducerStrategy &reducer;
+
+public:
+    explicit SumReduction(const IReducerStrategy &reducer) : reducer(reducer) {}
+
+    bool reduce(AST::Node::Ptr &node) const override {
+        auto *sumNode = node->as<AST::SumNode>();
+        if (!sumNode) return false;
+
+        bool changed = false;
+        for (AST::Node::Ptr &operand: sumNode->operands) {
+            if (operand->nodeType != AST::NodeType::NUMBER_LITERAL) changed |= reduce_child(reducer, operand);
+        }
+
+        // Reused between calls, the literal values have to be contiguous for the SIMD loads.
+        // Filled only after the operands are reduced, as nested sums use the same buffer.
+        thread_local std::vector<int> numbers;
+        numbers.clear();
+        for (const AST::Node::Ptr &operand: sumNode->operands) {
+            auto *number = operand->as<AST::NumberNode>();
+            if (!number) return changed;
+            numbers.push_back(number->value);
+        }
+
+        replace_node(node, AST::Number(simd_sum(numbers)));
+        return true;
+    }
+
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{AST::NodeType::SUM};
+    }
+};
+
+/// Reduces the operands from left to right and stops at the first one equal to `stopAt`,
+/// whose value is then the result. Without such an operand the result is `!stopAt`.
+template<AST::NodeType nodeType, bool stopAt>
+class ShortCircuitReduction : public IReductionRule {
+    const IReducerStrategy &reducer;
+
+public:
+    explicit ShortCircuitReduction(const IReducerStrategy &reducer) : reducer(reducer) {}
+
+    bool reduce(AST::Node::Ptr &node) const override {
+        auto *naryNode = node->as<AST::NaryOpBase<nodeType>>();
+        if (!naryNode) return false;
+
+        bool changed = false;
+        for (AST::Node::Ptr &operand: naryNode->operands) {
+            if (operand->nodeType != AST::NodeType::BOOLEAN_LITERAL) changed |= reduce_child(reducer, operand);
+
+            auto *boolean = operand->as<AST::BooleanNode>();
+            if (!boolean) return changed;
+            if (boolean->value == stopAt) {
+                replace_node(node, AST::Boolean(stopAt));
+                return true;
+            }
+        }
+
+        replace_node(node, AST::Boolean(!stopAt));
         return true;
     }
+
+    [[nodiscard]] std::optional<RulePattern> pattern() const override {
+        return RulePattern{nodeType};
+    }
+
+protected:
+    using ShortCircuitReduction_t = ShortCircuitReduction<nodeType, stopAt>;
+};
+
+struct AllReduction : public ShortCircuitReduction<AST::NodeType::ALL, false> {
+    using ShortCircuitReduction_t::ShortCircuitReduction;
+};
+struct AnyReduction : public ShortCircuitReduction<AST::NodeType::ANY, true> {
+    using ShortCircuitReduction_t::ShortCircuitReduction;
+};
+
+
+/// Owns reduction rules and dispatches each node only to the rules whose pattern it matches.
+/// The patterns are compiled into a jump table indexed by the kinds of the node and its first two children;
+/// each entry lists the candidate rules in registration order, so the first rule that applies is the same one
+/// a linear scan over all rules would find.
+class RuleRegistry {
+public:
+    struct MatchStats {
+        std::uint64_t dispatches;
+        /// Calls to IReductionRule::reduce made through the jump table
+        std::uint64_t attempts;
+        /// Calls a linear scan over all rules would have made for the same dispatches
+        std::uint64_t linearAttempts;
+
+        [[nodiscard]] std::uint64_t saved() const { return linearAttempts - attempts; }
+    };
+
+    /// Counting matches costs shared atomic updates on every dispatch, so it is only done on request.
+    explicit RuleRegistry(bool countMatches = false)
+        : table(NODE_KIND_COUNT * CHILD_KIND_COUNT * CHILD_KIND_COUNT),
+          stats(countMatches ? std::make_unique<AtomicStats>() : nullptr) {}
+
+    /// Registers a rule with lower priority than the already registered ones. Not thread-safe with apply.
+    void add(IReductionRule::Ptr rule) {
+        std::size_t rank = rules.size();
+        auto pattern = rule->pattern();
+
+        for (std::size_t nodeKind = 0; nodeKind < NODE_KIND_COUNT; ++nodeKind) {
+            if (pattern && nodeKind != static_cast<std::size_t>(pattern->nodeType)) continue;
+            for (std::size_t first = 0; first < CHILD_KIND_COUNT; ++first) {
+                if (pattern && !allows(pattern->first, first)) continue;
+                for (std::size_t second = 0; second < CHILD_KIND_COUNT; ++second) {
+                    if (pattern && !allows(pattern->second, second)) continue;
+                    table[index(nodeKind, first, second)].push_back({rule.get(), rank});
+                }
+            }
+        }
+        rules.push_back(std::move(rule));
+    }
+
+    [[nodiscard]] std::size_t size() const { return rules.size(); }
+
+    /// Applies the first registered rule that reduces the node. Returns whether there was one.
+    bool apply(AST::Node::Ptr &node) const {
+        const std::vector<Candidate> &candidates = table[dispatch_index(*node)];
+        if (!stats) {
+            for (const Candidate &candidate: candidates) {
+                if (candidate.rule->reduce(node)) return true;
+            }
+            return false;
+        }
+
+        std::uint64_t attempts = 0;
+        std::uint64_t linearAttempts = rules.size();
+        bool reduced = false;
+        for (const Candidate &candidate: candidates) {
+            attempts++;
+            if (candidate.rule->reduce(node)) {
+                linearAttempts = candidate.rank + 1;
+                reduced = true;
+                break;
+            }
+        }
+
+        stats->dispatches.fetch_add(1, std::memory_order_relaxed);
+        stats->attempts.fetch_add(attempts, std::memory_order_relaxed);
+        stats->linearAttempts.fetch_add(linearAttempts, std::memory_order_relaxed);
+        return reduced;
+    }
+
+    /// All zero unless the registry was created counting matches.
+    [[nodiscard]] MatchStats matchStats() const {
+        if (!stats) return {0, 0, 0};
+        return {stats->dispatches.load(), stats->attempts.load(), stats->linearAttempts.load()};
+    }
+
+private:
+    static constexpr std::size_t NODE_KIND_COUNT = AST::NODE_TYPE_COUNT;
+    /// Children kinds are node types, or NO_CHILD for nodes with less than two children
+    static constexpr std::size_t NO_CHILD = AST::NODE_TYPE_COUNT;
+    static constexpr std::size_t CHILD_KIND_COUNT = AST::NODE_TYPE_COUNT + 1;
+
+    struct Candidate {
+        const IReductionRule *rule;
+        std::size_t rank;
+    };
+
+    struct AtomicStats {
+        std::atomic<std::uint64_t> dispatches{0};
+        std::atomic<std::uint64_t> attempts{0};
+        std::atomic<std::uint64_t> linearAttempts{0};
+    };
+
+    std::vector<IReductionRule::Ptr> rules;
+    std::vector<std::vector<Candidate>> table;
+    std::unique_ptr<AtomicStats> stats;
+
+    static bool allows(RulePattern::KindSet kinds, std::size_t childKind) {
+        // a pattern constraining a missing child can never match
+        if (childKind == NO_CHILD) return kinds == RulePattern::ANY;
+        return kinds & (RulePattern::KindSet{1} << childKind);
+    }
+
+    static std::size_t index(std::size_t nodeKind, std::size_t first, std::size_t second) {
+        return (nodeKind * CHILD_KIND_COUNT + first) * CHILD_KIND_COUNT + second;
+    }
+
+    static std::size_t index(AST::NodeType nodeType, const AST::Node &first, const AST::Node &second) {
+        return index(static_cast<std::size_t>(nodeType), static_cast<std::size_t>(first.nodeType),
+                     static_cast<std::size_t>(second.nodeType));
+    }
+
+    template<AST::NodeType nodeType>
+    static std::size_t binary_index(const AST::Node &node) {
+        auto &binaryOp = static_cast<const AST::BinaryOpBase<nodeType> &>(node);
+        return index(nodeType, *binaryOp.left, *binaryOp.right);
+    }
+
+    template<AST::NodeType nodeType>
+    static std::size_t nary_index(const AST::Node &node) {
+        auto &operands = static_cast<const AST::NaryOpBase<nodeType> &>(node).operands;
+        std::size_t first = operands.size() > 0 ? static_cast<std::size_t>(operands[0]->nodeType) : NO_CHILD;
+        std::size_t second = operands.size() > 1 ? static_cast<std::size_t>(operands[1]->nodeType) : NO_CHILD;
+        return index(static_cast<std::size_t>(nodeType), first, second);
+    }
+
+    /// Reads the first two children kinds straight from the node, without visiting the rest.
+    static std::size_t dispatch_index(const AST::Node &node) {
+        switch (node.nodeType) {
+            case AST::NodeType::ADD: return binary_index<AST::NodeType::ADD>(node);
+            case AST::NodeType::SUBTRACT: return binary_index<AST::NodeType::SUBTRACT>(node);
+            case AST::NodeType::LESS_THAN: return binary_index<AST::NodeType::LESS_THAN>(node);
+            case AST::NodeType::GREATER_THAN: return binary_index<AST::NodeType::GREATER_THAN>(node);
+            case AST::NodeType::AND: return binary_index<AST::NodeType::AND>(node);
+            case AST::NodeType::OR: return binary_index<AST::NodeType::OR>(node);
+            case AST::NodeType::IF: {
+                auto &ifNode = static_cast<const AST::IfNode &>(node);
+                return index(AST::NodeType::IF, *ifNode.condition, *ifNode.whenTrue);
+            }
+            case AST::NodeType::SUM: return nary_index<AST::NodeType::SUM>(node);
+            case AST::NodeType::ALL: return nary_index<AST::NodeType::ALL>(node);
+            case AST::NodeType::ANY: return nary_index<AST::NodeType::ANY>(node);
+            default: return index(static_cast<std::size_t>(node.nodeType), NO_CHILD, NO_CHILD);
+        }
+    }
 };
 
 
 class DumbReducerService : public IReducerStrategy {
-    std::vector<IReductionRule::Ptr> reductionRules;
+    RuleRegistry reductionRules;
 
 public:
-    DumbReducerService() {
+    /// See RuleRegistry for the cost of counting matches.
+    explicit DumbReducerService(bool countMatches = false) : reductionRules(countMatches) {
         // simple binary reductions
-        reductionRules.push_back(std::make_unique<AddSimpleReduction>());
-        reductionRules.push_back(std::make_unique<SubtractSimpleReduction>());
-        reductionRules.push_back(std::make_unique<LessThanSimpleReduction>());
-        reductionRules.push_back(std::make_unique<GreaterThanSimpleReduction>());
-        reductionRules.push_back(std::make_unique<AndSimpleReduction>());
-        reductionRules.push_back(std::make_unique<OrSimpleReduction>());
+        reductionRules.add(std::make_unique<AddSimpleReduction>());
+        reductionRules.add(std::make_unique<SubtractSimpleReduction>());
+        reductionRules.add(std::make_unique<LessThanSimpleReduction>());
+        reductionRules.add(std::make_unique<GreaterThanSimpleReduction>());
+        reductionRules.add(std::make_unique<AndSimpleReduction>());
+        reductionRules.add(std::make_unique<OrSimpleReduction>());
 
         // left reductions
-        reductionRules.push_back(std::make_unique<AddLeftReduction>(*this));
-        reductionRules.push_back(std::make_unique<SubtractLeftReduction>(*this));
-        reductionRules.push_back(std::make_unique<LessThanLeftReduction>(*this));
-        reductionRules.push_back(std::make_unique<GreaterThanLeftReduction>(*this));
-        reductionRules.push_back(std::make_unique<AndLeftReduction>(*this));
-        reductionRules.push_back(std::make_unique<OrLeftReduction>(*this));
+        reductionRules.add(std::make_unique<AddLeftReduction>(*this));
+        reductionRules.add(std::make_unique<SubtractLeftReduction>(*this));
+        reductionRules.add(std::make_unique<LessThanLeftReduction>(*this));
+        reductionRules.add(std::make_unique<GreaterThanLeftReduction>(*this));
+        reductionRules.add(std::make_unique<AndLeftReduction>(*this));
+        reductionRules.add(std::make_unique<OrLeftReduction>(*this));
 
         // right reductions
-        reductionRules.push_back(std::make_unique<AddRightReduction>(*this));
-        reductionRules.push_back(std::make_unique<SubtractRightReduction>(*this));
-        reductionRules.push_back(std::make_unique<LessThanRightReduction>(*this));
-        reductionRules.push_back(std::make_unique<GreaterThanRightReduction>(*this));
-        reductionRules.push_back(std::make_unique<AndRightReduction>(*this));
-        reductionRules.push_back(std::make_unique<OrRightReduction>(*this));
+        reductionRules.add(std::make_unique<AddRightReduction>(*this));
+        reductionRules.add(std::make_unique<SubtractRightReduction>(*this));
+        reductionRules.add(std::make_unique<LessThanRightReduction>(*this));
+        reductionRules.add(std::make_unique<GreaterThanRightReduction>(*this));
+        reductionRules.add(std::make_unique<AndRightReduction>(*this));
+        reductionRules.add(std::make_unique<OrRightReduction>(*this));
 
         // if reductions
-        reductionRules.push_back(std::make_unique<IfConditionReduction>(*this));
-        reductionRules.push_back(std::make_unique<IfResultReduction>());
+        reductionRules.add(std::make_unique<IfConditionReduction>(*this));
+        reductionRules.add(std::make_unique<IfResultReduction>());
+
+        // n-ary reductions
+        reductionRules.add(std::make_unique<SumReduction>(*this));
+        reductionRules.add(std::make_unique<AllReduction>(*this));
+        reductionRules.add(std::make_unique<AnyReduction>(*this));
     }
 
     void reduce(AST::Node::Ptr &node) const override {
-        while (std::ranges::any_of(reductionRules, [&](const IReductionRule::Ptr &rule) -> bool {
-            return rule->reduce(node);
-        }));
+        while (reductionRules.apply(node)) {
+            record_reduction_step();
+        }
     };
+
+    /// Registers a custom rule, tried after the built-in ones.
+    void addRule(IReductionRule::Ptr rule) {
+        reductionRules.add(std::move(rule));
+    }
+
+    [[nodiscard]] RuleRegistry::MatchStats matchStats() const {
+        return reductionRules.matchStats();
+    }
 };
 
 
@@ -299,6 +661,9 @@ public:
     const OrRightReduction orRightReduction{*this};
     const IfConditionReduction ifConditionReduction{*this};
     const IfResultReduction ifResultReduction{};
+    const SumReduction sumReduction{*this};
+    const AllReduction allReduction{*this};
+    const AnyReduction anyReduction{*this};
 
     void reduce(AST::Node::Ptr &node) const override {
         bool haveReduced = true;
@@ -309,6 +674,7 @@ public:
             switch (node->nodeType) {
                 case AST::NodeType::NUMBER_LITERAL:
                 case AST::NodeType::BOOLEAN_LITERAL:
+                case AST::NodeType::PARAMETER:
                     // Irreducible
                     break;
                 case AST::NodeType::ADD:
@@ -345,7 +711,18 @@ public:
                     haveReduced |= ifConditionReduction.reduce(node);
                     haveReduced |= ifResultReduction.reduce(node);
                     break;
+                case AST::NodeType::SUM:
+                    haveReduced |= sumReduction.reduce(node);
+                    break;
+                case AST::NodeType::ALL:
+                    haveReduced |= allReduction.reduce(node);
+                    break;
+                case AST::NodeType::ANY:
+                    haveReduced |= anyReduction.reduce(node);
+                    break;
             }
+
+            if (haveReduced) record_reduction_step();
         }
     };
 };
@@ -2,8 +2,10 @@
 #define TYPES_H
 
 #include "AST.h"
+#include <span>
 
-static void init_types(AST::Node &tree) {
+/// Infers the value type of every node. Parameter slots take their type from parameterTypes, missing ones stay UNKNOWN.
+static void init_types(AST::Node &tree, std::span<const AST::ValueType> parameterTypes = {}) {
     if (tree.type != AST::ValueType::UNKNOWN) return;
 
     switch (tree.nodeType) {
@@ -17,63 +19,105 @@ static void init_types(AST::Node &tree) {
         }
         case AST::NodeType::ADD: {
             auto binaryOp = tree.as<AST::AddNode>();
-            init_types(*binaryOp->left);
-            init_types(*binaryOp->right);
+            init_types(*binaryOp->left, parameterTypes);
+            init_types(*binaryOp->right, parameterTypes);
             if (binaryOp->left->type == AST::ValueType::NUMBER && binaryOp->right->type == AST::ValueType::NUMBER)
                 binaryOp->type = AST::ValueType::NUMBER;
             break;
         }
         case AST::NodeType::SUBTRACT: {
             auto binaryOp = tree.as<AST::SubtractNode>();
-            init_types(*binaryOp->left);
-            init_types(*binaryOp->right);
+            init_types(*binaryOp->left, parameterTypes);
+            init_types(*binaryOp->right, parameterTypes);
             if (binaryOp->left->type == AST::ValueType::NUMBER && binaryOp->right->type == AST::ValueType::NUMBER)
                 binaryOp->type = AST::ValueType::NUMBER;
             break;
         }
         case AST::NodeType::LESS_THAN: {
             auto binaryOp = tree.as<AST::LessThanNode>();
-            init_types(*binaryOp->left);
-            init_types(*binaryOp->right);
+            init_types(*binaryOp->left, parameterTypes);
+            init_types(*binaryOp->right, parameterTypes);
             if (binaryOp->left->type == AST::ValueType::NUMBER && binaryOp->right->type == AST::ValueType::NUMBER)
                 binaryOp->type = AST::ValueType::BOOLEAN;
             break;
         }
         case AST::NodeType::GREATER_THAN: {
             auto binaryOp = tree.as<AST::GreaterThanNode>();
-            init_types(*binaryOp->left);
-            init_types(*binaryOp->right);
+            init_types(*binaryOp->left, parameterTypes);
+            init_types(*binaryOp->right, parameterTypes);
             if (binaryOp->left->type == AST::ValueType::NUMBER && binaryOp->right->type == AST::ValueType::NUMBER)
                 binaryOp->type = AST::ValueType::BOOLEAN;
             break;
         }
         case AST::NodeType::AND: {
             auto binaryOp = tree.as<AST::AndNode>();
-            init_types(*binaryOp->left);
-            init_types(*binaryOp->right);
+            init_types(*binaryOp->left, parameterTypes);
+            init_types(*binaryOp->right, parameterTypes);
             if (binaryOp->left->type == AST::ValueType::BOOLEAN && binaryOp->right->type == AST::ValueType::BOOLEAN)
                 binaryOp->type = AST::ValueType::BOOLEAN;
             break;
         }
         case AST::NodeType::OR: {
-            auto binaryOp = tree.as<AST::AndNode>();
-            init_types(*binaryOp->left);
-            init_types(*binaryOp->right);
+            auto binaryOp = tree.as<AST::OrNode>();
+            init_types(*binaryOp->left, parameterTypes);
+            init_types(*binaryOp->right, parameterTypes);
             if (binaryOp->left->type == AST::ValueType::BOOLEAN && binaryOp->right->type == AST::ValueType::BOOLEAN)
                 binaryOp->type = AST::ValueType::BOOLEAN;
             break;
         }
         case AST::NodeType::IF: {
             auto ternaryIf = tree.as<AST::IfNode>();
-            init_types(*ternaryIf->condition);
-            init_types(*ternaryIf->whenFalse);
-            init_types(*ternaryIf->whenTrue);
+            init_types(*ternaryIf->condition, parameterTypes);
+            init_types(*ternaryIf->whenFalse, parameterTypes);
+            init_types(*ternaryIf->whenTrue, parameterTypes);
             if (ternaryIf->condition->type == AST::ValueType::BOOLEAN && ternaryIf->whenTrue->type == ternaryIf->whenFalse->type) {
                 ternaryIf->type = ternaryIf->whenTrue->type;
             }
             break;
         }
+        case AST::NodeType::SUM: {
+            auto naryOp = tree.as<AST::SumNode>();
+            bool allNumbers = true;
+            for (auto &operand: naryOp->operands) {
+                init_types(*operand, parameterTypes);
+                allNumbers &= operand->type == AST::ValueType::NUMBER;
+            }
+            if (allNumbers) naryOp->type = AST::ValueType::NUMBER;
+            break;
+        }
+        case AST::NodeType::ALL: {
+            auto naryOp = tree.as<AST::AllNode>();
+            bool allBooleans = true;
+            for (auto &operand: naryOp->operands) {
+                init_types(*operand, parameterTypes);
+                allBooleans &= operand->type == AST::ValueType::BOOLEAN;
+            }
+            if (allBooleans) naryOp->type = AST::ValueType::BOOLEAN;
+            break;
+        }
+        case AST::NodeType::ANY: {
+            auto naryOp = tree.as<AST::AnyNode>();
+            bool allBooleans = true;
+            for (auto &operand: naryOp->operands) {
+                init_types(*operand, parameterTypes);
+                allBooleans &= operand->type == AST::ValueType::BOOLEAN;
+            }
+            if (allBooleans) naryOp->type = AST::ValueType::BOOLEAN;
+            break;
+        }
+        case AST::NodeType::PARAMETER: {
+            auto parameter = tree.as<AST::ParameterNode>();
+            if (parameter->slot < parameterTypes.size())
+                parameter->type = parameterTypes[parameter->slot];
+            break;
+        }
     }
 }
 
+/// Forgets the inferred types, so that init_types infers them again, e.g. with other parameter types.
+static void reset_types(AST::Node &tree) {
+    tree.type = AST::ValueType::UNKNOWN;
+    AST::for_each_child(tree, [](AST::Node::Ptr &child) { reset_types(*child); });
+}
+
 #endif
\ No newline at end of file
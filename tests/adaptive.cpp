@@ -0,0 +1,188 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "../src/AST.h"
+#include "../src/adaptive.h"
+#include "../src/reductions.h"
+#include <future>
+#include <thread>
+
+using namespace testing;
+
+/// Cost units charged by the CountingReducers of this thread
+thread_local double chargedCost = 0;
+
+/// Reduces correctly and charges a fixed cost per reduction, a cost per node and an extra cost per Sum node
+struct CountingReducer : public IReducerStrategy {
+    double fixedCost;
+    double costPerNode;
+    double costPerSum;
+    SmartReducerService reducer;
+
+    CountingReducer(double fixedCost, double costPerNode, double costPerSum = 0)
+        : fixedCost(fixedCost), costPerNode(costPerNode), costPerSum(costPerSum) {}
+
+    void reduce(AST::Node::Ptr &node) const override {
+        auto programProfile = profile(*node);
+        chargedCost += fixedCost + costPerNode * static_cast<double>(programProfile.nodes) +
+                       costPerSum * static_cast<double>(programProfile.count(AST::NodeType::SUM));
+        reducer.reduce(node);
+    }
+};
+
+static double countedCost(const IReducerStrategy &strategy, AST::Node::Ptr &node) {
+    double before = chargedCost;
+    strategy.reduce(node);
+    return chargedCost - before;
+}
+
+static AST::Node::Ptr balancedSum(int depth) {
+    if (depth == 0) return AST::Number(1);
+    return AST::Add(balancedSum(depth - 1), balancedSum(depth - 1));
+}
+
+TEST(ProgramProfile, CountsNodesDepthAndOperators) {
+    auto node = AST::If(AST::LessThan(AST::Number(1), AST::Number(2)), AST::Add(AST::Number(1), AST::Number(2)), AST::Number(3));
+
+    auto result = profile(*node);
+
+    EXPECT_THAT(result.nodes, Eq(8));
+    EXPECT_THAT(result.depth, Eq(2));
+    EXPECT_THAT(result.count(AST::NodeType::NUMBER_LITERAL), Eq(5));
+    EXPECT_THAT(result.count(AST::NodeType::IF), Eq(1));
+    EXPECT_THAT(result.ifDensity(), DoubleEq(1.0 / 8));
+}
+
+TEST(AdaptiveReducer, UsesTheFirstEngineUntilCalibrated) {
+    CountingReducer expensiveReducer(1000, 10);
+    CountingReducer cheapReducer(0, 1);
+    AdaptiveReducer reducer(1024, countedCost);
+    reducer.addEngine("expensive", expensiveReducer);
+    reducer.addEngine("cheap", cheapReducer);
+
+    AST::Node::Ptr node = AST::Add(AST::Number(1), AST::Number(2));
+    reducer.reduce(node);
+
+    EXPECT_FALSE(reducer.calibrated());
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(3));
+    ASSERT_THAT(reducer.decisions(), SizeIs(1));
+    EXPECT_THAT(reducer.decisions()[0].engine, Eq(0));
+}
+
+TEST(AdaptiveReducer, RoutesToTheCheaperEngineAfterCalibration) {
+    // the setup cost pays off for programs of more than 500 nodes
+    CountingReducer setupReducer(10000, 1);
+    CountingReducer leanReducer(0, 21);
+    AdaptiveReducer reducer(1024, countedCost);
+    reducer.addEngine("setup", setupReducer);
+    reducer.addEngine("lean", leanReducer);
+    reducer.calibrate();
+
+    AST::Node::Ptr small = AST::If(
+            AST::LessThan(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(2)),
+            AST::Subtract(AST::Number(1), AST::Number(2)),
+            AST::Add(AST::Number(1), AST::Number(2))
+    );
+    reducer.reduce(small);
+    AST::Node::Ptr large = balancedSum(10);
+    reducer.reduce(large);
+
+    ASSERT_THAT(small->as<AST::NumberNode>()->value, Eq(3));
+    ASSERT_THAT(large->as<AST::NumberNode>()->value, Eq(1024));
+    auto decisions = reducer.decisions();
+    ASSERT_THAT(decisions, SizeIs(2));
+    EXPECT_THAT(decisions[0].engine, Eq(1));
+    EXPECT_THAT(decisions[0].profile.nodes, Eq(12));
+    EXPECT_THAT(decisions[0].actualCost, DoubleEq(12 * 21));
+    EXPECT_THAT(decisions[0].predictedCost, DoubleNear(12 * 21, 1));
+    EXPECT_THAT(decisions[1].engine, Eq(0));
+    EXPECT_THAT(decisions[1].actualCost, DoubleEq(10000 + 2047));
+
+    auto stats = reducer.engineStats();
+    EXPECT_THAT(stats[0].name, Eq("setup"));
+    EXPECT_THAT(stats[0].routed, Eq(1));
+    EXPECT_THAT(stats[1].routed, Eq(1));
+}
+
+TEST(AdaptiveReducer, RoutesByTheOperatorMix) {
+    CountingReducer binaryReducer(0, 5, 200);
+    CountingReducer naryReducer(0, 8);
+    AdaptiveReducer reducer(1024, countedCost);
+    reducer.addEngine("binary", binaryReducer);
+    reducer.addEngine("nary", naryReducer);
+    reducer.calibrate();
+
+    AST::Operands operands;
+    for (int i = 0; i < 50; ++i) {
+        AST::Operands inner;
+        inner.push_back(AST::Number(i));
+        inner.push_back(AST::Number(2));
+        operands.push_back(AST::Sum(std::move(inner)));
+    }
+    AST::Node::Ptr sums = AST::Sum(std::move(operands));
+    AST::Node::Ptr additions = balancedSum(7);
+    ASSERT_THAT(profile(*sums).nodes, Lt(profile(*additions).nodes));
+
+    reducer.reduce(sums);
+    reducer.reduce(additions);
+
+    ASSERT_THAT(sums->as<AST::NumberNode>()->value, Eq(49 * 50 / 2 + 100));
+    ASSERT_THAT(additions->as<AST::NumberNode>()->value, Eq(128));
+    auto decisions = reducer.decisions();
+    ASSERT_THAT(decisions, SizeIs(2));
+    EXPECT_THAT(decisions[0].engine, Eq(1));
+    EXPECT_THAT(decisions[1].engine, Eq(0));
+}
+
+/// Pauses in its first reduction until `proceed` is fulfilled, recording whether that happened in time
+struct PausingReducer : public IReducerStrategy {
+    SmartReducerService reducer;
+    mutable std::promise<void> entered;
+    std::shared_future<void> proceed;
+    mutable std::once_flag once;
+    mutable bool proceededInTime = false;
+
+    void reduce(AST::Node::Ptr &node) const override {
+        std::call_once(once, [&] {
+            entered.set_value();
+            proceededInTime = proceed.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+        });
+        reducer.reduce(node);
+    }
+};
+
+TEST(AdaptiveReducer, ReducesWhileCalibrating) {
+    SmartReducerService smartReducer;
+    std::promise<void> reduced;
+    PausingReducer pausingReducer;
+    pausingReducer.proceed = reduced.get_future().share();
+    AdaptiveReducer reducer;
+    reducer.addEngine("smart", smartReducer);
+    reducer.addEngine("pausing", pausingReducer);
+
+    std::thread calibration([&] { reducer.calibrate(1); });
+    pausingReducer.entered.get_future().wait();
+
+    AST::Node::Ptr node = AST::Add(AST::Number(1), AST::Number(2));
+    reducer.reduce(node);
+    reduced.set_value();
+    calibration.join();
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(3));
+    EXPECT_TRUE(pausingReducer.proceededInTime);
+    EXPECT_TRUE(reducer.calibrated());
+}
+
+TEST(AdaptiveReducer, DecisionLogIsBounded) {
+    SmartReducerService smartReducer;
+    AdaptiveReducer reducer(2);
+    reducer.addEngine("smart", smartReducer);
+
+    for (int i = 0; i < 5; ++i) {
+        AST::Node::Ptr node = AST::Number(i);
+        reducer.reduce(node);
+    }
+
+    EXPECT_THAT(reducer.decisions(), SizeIs(2));
+    EXPECT_THAT(reducer.engineStats()[0].routed, Eq(5));
+}
@@ -0,0 +1,192 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "../src/AST.h"
+#include "../src/cache.h"
+#include "../src/reductions.h"
+#include <thread>
+
+using namespace testing;
+
+TEST(StructuralHash, EqualTreesHaveEqualHashes) {
+    auto first = AST::Add(AST::Number(1), AST::Subtract(AST::Number(2), AST::Number(3)));
+    auto second = AST::Add(AST::Number(1), AST::Subtract(AST::Number(2), AST::Number(3)));
+
+    EXPECT_THAT(structural_hash(*first), Eq(structural_hash(*second)));
+}
+
+TEST(StructuralHash, DifferentTreesHaveDifferentHashes) {
+    EXPECT_THAT(structural_hash(*AST::Number(1)), Ne(structural_hash(*AST::Number(2))));
+    EXPECT_THAT(structural_hash(*AST::Number(1)), Ne(structural_hash(*AST::Boolean(true))));
+    EXPECT_THAT(structural_hash(*AST::Add(AST::Number(1), AST::Number(2))),
+                Ne(structural_hash(*AST::Subtract(AST::Number(1), AST::Number(2)))));
+    EXPECT_THAT(structural_hash(*AST::Add(AST::Number(1), AST::Number(2))),
+                Ne(structural_hash(*AST::Add(AST::Number(2), AST::Number(1)))));
+}
+
+TEST(EvaluationCache, CountsHitsAndMisses) {
+    EvaluationCache cache(16);
+
+    EXPECT_THAT(cache.lookup(42), Eq(std::nullopt));
+    cache.insert(42, 7);
+    EXPECT_THAT(cache.lookup(42), Optional(AST::Value(7)));
+
+    auto stats = cache.stats();
+    EXPECT_THAT(stats.hits, Eq(1));
+    EXPECT_THAT(stats.misses, Eq(1));
+    EXPECT_THAT(stats.insertions, Eq(1));
+}
+
+TEST(EvaluationCache, StaysWithinCapacity) {
+    EvaluationCache cache(8, 1);
+
+    for (std::uint64_t hash = 0; hash < 100; ++hash) cache.insert(hash, static_cast<int>(hash));
+
+    EXPECT_THAT(cache.size(), Eq(8));
+    EXPECT_THAT(cache.stats().evictions, Eq(92));
+}
+
+TEST(EvaluationCache, KeepsRecentlyUsedEntries) {
+    EvaluationCache cache(2, 1);
+    cache.insert(1, 1);
+    cache.insert(2, 2);
+
+    cache.lookup(1);
+    cache.insert(3, 3);
+
+    EXPECT_THAT(cache.lookup(1), Optional(AST::Value(1)));
+    EXPECT_THAT(cache.lookup(2), Eq(std::nullopt));
+    EXPECT_THAT(cache.lookup(3), Optional(AST::Value(3)));
+}
+
+TEST(EvaluationCache, ConcurrentAccess) {
+    EvaluationCache cache(64);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < 1000; ++i) {
+                std::uint64_t hash = hash_combine(t, i % 100);
+                if (!cache.lookup(hash)) cache.insert(hash, i);
+            }
+        });
+    }
+    for (auto &thread: threads) thread.join();
+
+    auto stats = cache.stats();
+    EXPECT_THAT(stats.hits + stats.misses, Eq(4000));
+    EXPECT_THAT(cache.size(), Le(64));
+}
+
+TEST(CachingReducer, ReducesLikeTheWrappedStrategy) {
+    SmartReducerService smartReducer;
+    EvaluationCache cache(16);
+    CachingReducer reducer(smartReducer, cache);
+
+    AST::Node::Ptr node = AST::If(
+            AST::LessThan(AST::Number(1), AST::Number(2)),
+            AST::Add(AST::Number(1), AST::Number(2)),
+            AST::Number(0)
+    );
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::NUMBER_LITERAL));
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(3));
+}
+
+TEST(CachingReducer, RepeatedProgramHitsTheCache) {
+    SmartReducerService smartReducer;
+    EvaluationCache cache(16);
+    CachingReducer reducer(smartReducer, cache);
+
+    for (int i = 0; i < 3; ++i) {
+        AST::Node::Ptr node = AST::Subtract(AST::Number(10), AST::Add(AST::Number(1), AST::Number(2)));
+        reducer.reduce(node);
+        ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(7));
+    }
+
+    EXPECT_THAT(cache.stats().hits, Eq(2));
+}
+
+TEST(CachingReducer, CachedSubtreesAreShortCircuited) {
+    SmartReducerService smartReducer;
+    EvaluationCache cache(16);
+    CachingReducer reducer(smartReducer, cache);
+
+    // a value the wrapped reducer could never produce proves that the fragment was not reduced again
+    cache.insert(structural_hash(*AST::Add(AST::Number(1), AST::Number(2))), 100);
+
+    AST::Node::Ptr node = AST::Add(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(1));
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(101));
+}
+
+TEST(CachingReducer, SharedFragmentHitsAcrossPrograms) {
+    SmartReducerService smartReducer;
+    EvaluationCache cache(16);
+    CachingReducer reducer(smartReducer, cache);
+
+    AST::Node::Ptr first = AST::Add(AST::Subtract(AST::Number(10), AST::Number(3)), AST::Number(1));
+    reducer.reduce(first);
+    AST::Node::Ptr second = AST::Add(AST::Subtract(AST::Number(10), AST::Number(3)), AST::Number(2));
+    reducer.reduce(second);
+
+    ASSERT_THAT(first->as<AST::NumberNode>()->value, Eq(8));
+    ASSERT_THAT(second->as<AST::NumberNode>()->value, Eq(9));
+    auto stats = cache.stats();
+    EXPECT_THAT(stats.hits, Eq(1));
+    EXPECT_THAT(stats.misses, Eq(3));
+    EXPECT_THAT(stats.insertions, Eq(3));
+}
+
+TEST(CachingReducer, CachedAncestorEndsTheLookup) {
+    SmartReducerService smartReducer;
+    EvaluationCache cache(16);
+    CachingReducer reducer(smartReducer, cache);
+    auto program = [] {
+        return AST::Add(AST::Add(AST::Number(1), AST::Number(2)), AST::Subtract(AST::Number(3), AST::Number(4)));
+    };
+
+    AST::Node::Ptr node = program();
+    reducer.reduce(node);
+    auto before = cache.stats();
+    node = program();
+    reducer.reduce(node);
+    auto after = cache.stats();
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(2));
+    EXPECT_THAT(after.hits - before.hits, Eq(1));
+    EXPECT_THAT(after.misses - before.misses, Eq(0));
+}
+
+TEST(CachingReducer, UntakenBranchIsNotCached) {
+    SmartReducerService smartReducer;
+    EvaluationCache cache(16);
+    CachingReducer reducer(smartReducer, cache);
+
+    AST::Node::Ptr node = AST::If(
+            AST::Boolean(false),
+            AST::Add(AST::Number(1), AST::Number(2)),
+            AST::Subtract(AST::Number(5), AST::Number(1))
+    );
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(4));
+    EXPECT_THAT(cache.lookup(structural_hash(*AST::Add(AST::Number(1), AST::Number(2)))), Eq(std::nullopt));
+    EXPECT_THAT(cache.lookup(structural_hash(*AST::Subtract(AST::Number(5), AST::Number(1)))), Optional(AST::Value(4)));
+}
+
+TEST(CachingReducer, ProgramWithParameterIsNotCached) {
+    SmartReducerService smartReducer;
+    EvaluationCache cache(16);
+    CachingReducer reducer(smartReducer, cache);
+
+    AST::Node::Ptr node = AST::Add(AST::Add(AST::Number(1), AST::Number(2)), AST::Parameter(0));
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::ADD));
+    EXPECT_THAT(AST::literal_value(*node->as<AST::AddNode>()->left), Optional(AST::Value(3)));
+    // only the literal-valued fragment is stored
+    EXPECT_THAT(cache.stats().insertions, Eq(1));
+}
@@ -0,0 +1,71 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "../src/AST.h"
+#include "../src/incremental.h"
+
+using namespace testing;
+
+/// A balanced sum of `1`s with 2^depth leaves
+static AST::Node::Ptr balancedSum(int depth) {
+    if (depth == 0) return AST::Number(1);
+    return AST::Add(balancedSum(depth - 1), balancedSum(depth - 1));
+}
+
+TEST(IncrementalEvaluator, EvaluatesWithoutConsumingTheProgram) {
+    IncrementalEvaluator evaluator(AST::Subtract(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(10)));
+
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value(-7)));
+    EXPECT_THAT(evaluator.program().nodeType, Eq(AST::NodeType::SUBTRACT));
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value(-7)));
+    EXPECT_THAT(evaluator.evaluations(), Eq(2));
+}
+
+TEST(IncrementalEvaluator, ReplacingALeafReevaluatesOnlyItsAncestors) {
+    const int depth = 10;
+    IncrementalEvaluator evaluator(balancedSum(depth));
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value(1 << depth)));
+    std::size_t initialEvaluations = evaluator.evaluations();
+
+    std::vector<std::size_t> path(depth, 0);
+    auto previous = evaluator.replace(path, AST::Number(101));
+
+    EXPECT_THAT(previous->as<AST::NumberNode>()->value, Eq(1));
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value((1 << depth) + 100)));
+    EXPECT_THAT(evaluator.evaluations() - initialEvaluations, Eq(depth));
+}
+
+TEST(IncrementalEvaluator, ReplacingASubtree) {
+    IncrementalEvaluator evaluator(AST::If(
+            AST::LessThan(AST::Number(1), AST::Number(2)),
+            AST::Add(AST::Number(1), AST::Number(2)),
+            AST::Number(0)
+    ));
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value(3)));
+
+    std::vector<std::size_t> condition{0};
+    evaluator.replace(condition, AST::GraterThan(AST::Number(1), AST::Number(2)));
+
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value(0)));
+    EXPECT_THAT(evaluator.at(condition).nodeType, Eq(AST::NodeType::GREATER_THAN));
+}
+
+TEST(IncrementalEvaluator, IllTypedEditIsReportedAndCanBeUndone) {
+    IncrementalEvaluator evaluator(AST::Add(AST::Number(1), AST::Number(2)));
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value(3)));
+
+    std::vector<std::size_t> right{1};
+    auto previous = evaluator.replace(right, AST::Boolean(true));
+    EXPECT_THAT(evaluator.evaluate(), Eq(std::nullopt));
+
+    evaluator.replace(right, std::move(previous));
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value(3)));
+}
+
+TEST(IncrementalEvaluator, ReplacingTheWholeProgram) {
+    IncrementalEvaluator evaluator(AST::Number(1));
+
+    evaluator.replace({}, AST::And(AST::Boolean(true), AST::Boolean(false)));
+
+    EXPECT_THAT(evaluator.evaluate(), Optional(AST::Value(false)));
+}
@@ -0,0 +1,153 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "../src/AST.h"
+#include "../src/memory.h"
+#include "../src/reductions.h"
+
+using namespace testing;
+
+TEST(MemoryAccounting, FootprintCountsNodesByType) {
+    auto node = AST::If(AST::LessThan(AST::Number(1), AST::Number(2)), AST::Number(3), AST::Number(4));
+
+    auto stats = footprint(*node);
+
+    EXPECT_THAT(stats.live(AST::NodeType::IF), Eq(1));
+    EXPECT_THAT(stats.live(AST::NodeType::LESS_THAN), Eq(1));
+    EXPECT_THAT(stats.live(AST::NodeType::NUMBER_LITERAL), Eq(4));
+    EXPECT_THAT(stats.liveBytes, Eq(sizeof(AST::IfNode) + sizeof(AST::LessThanNode) + 4 * sizeof(AST::NumberNode)));
+}
+
+TEST(MemoryAccounting, ScopeRecordsFactoryAllocations) {
+    MemoryAccount account;
+    {
+        MemoryScope scope(account);
+        auto node = AST::Add(AST::Number(1), AST::Number(2));
+
+        EXPECT_THAT(account.stats().live(AST::NodeType::ADD), Eq(1));
+        EXPECT_THAT(account.stats().live(AST::NodeType::NUMBER_LITERAL), Eq(2));
+        EXPECT_THAT(account.stats().bytesAllocated, Eq(sizeof(AST::AddNode) + 2 * sizeof(AST::NumberNode)));
+    }
+
+    const auto &stats = account.stats();
+    EXPECT_THAT(stats.allocations, Eq(3));
+    EXPECT_THAT(stats.frees, Eq(3));
+    EXPECT_THAT(stats.liveBytes, Eq(0));
+    EXPECT_THAT(stats.peakLiveBytes, Eq(sizeof(AST::AddNode) + 2 * sizeof(AST::NumberNode)));
+    EXPECT_THAT(stats.live(AST::NodeType::ADD), Eq(0));
+    EXPECT_THAT(stats.live(AST::NodeType::NUMBER_LITERAL), Eq(0));
+}
+
+TEST(MemoryAccounting, OperandArraysOfNaryNodesAreRecorded) {
+    auto expectedBytes = sizeof(AST::SumNode) + 5000 * sizeof(AST::Node::Ptr);
+
+    MemoryAccount account;
+    {
+        MemoryScope scope(account);
+        AST::Operands operands;
+        operands.reserve(5000);
+        for (int i = 0; i < 5000; ++i) operands.push_back(AST::Number(i));
+        auto node = AST::Sum(std::move(operands));
+
+        // the operand array is moved into the node, not copied
+        EXPECT_THAT(account.stats().allocations, Eq(5000 + 2));
+        EXPECT_THAT(account.stats().bytesAllocated, Eq(expectedBytes + 5000 * sizeof(AST::NumberNode)));
+        EXPECT_THAT(footprint(*node).liveBytes, Eq(expectedBytes + 5000 * sizeof(AST::NumberNode)));
+    }
+
+    EXPECT_THAT(account.stats().frees, Eq(5000 + 2));
+    EXPECT_THAT(account.stats().bytesFreed, Eq(expectedBytes + 5000 * sizeof(AST::NumberNode)));
+}
+
+TEST(MemoryAccounting, NestedScopesReportToEnclosingAccounts) {
+    MemoryAccount outer;
+    MemoryAccount inner;
+    {
+        MemoryScope outerScope(outer);
+        auto first = AST::Number(1);
+        {
+            MemoryScope innerScope(inner);
+            auto second = AST::Number(2);
+        }
+    }
+
+    EXPECT_THAT(inner.stats().allocations, Eq(1));
+    EXPECT_THAT(outer.stats().allocations, Eq(2));
+    EXPECT_THAT(AST::allocationObserver, IsNull());
+}
+
+TEST(MemoryAccounting, ReducerRecordsStepsAndFreesTheWholeProgram) {
+    SmartReducerService smartReducer;
+    AccountingReducer reducer(smartReducer);
+
+    AST::Node::Ptr node = AST::Add(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(3));
+    auto programBytes = footprint(*node).liveBytes;
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(6));
+    const auto &stats = reducer.account().stats();
+    // the outer pass reduces the left operand and then the sum itself
+    EXPECT_THAT(stats.reductionSteps, Eq(2));
+    EXPECT_THAT(stats.allocations, Eq(2));
+    // the input program is freed and the result is handed back to the caller
+    EXPECT_THAT(stats.liveBytes, Eq(0));
+    for (std::size_t nodeType = 0; nodeType < AST::NODE_TYPE_COUNT; ++nodeType) {
+        EXPECT_THAT(stats.liveNodes[nodeType], Eq(0));
+    }
+    // the whole program is live when the first literal is created
+    EXPECT_THAT(stats.peakLiveBytes, Eq(programBytes + static_cast<std::int64_t>(sizeof(AST::NumberNode))));
+}
+
+TEST(MemoryAccounting, LiveNodesDuringReductionAreNeverNegative) {
+    /// Checks the live node counts of the enclosing AccountingReducer after every reduction step
+    struct CheckingObserver : public MemoryAccount {
+        const MemoryAccount *reducerAccount = nullptr;
+        bool sawNegative = false;
+
+        void reductionStep() override {
+            MemoryAccount::reductionStep();
+            for (auto live: reducerAccount->stats().liveNodes) sawNegative |= live < 0;
+        }
+    };
+
+    SmartReducerService smartReducer;
+    AccountingReducer reducer(smartReducer);
+    CheckingObserver observer;
+    observer.reducerAccount = &reducer.account();
+
+    AST::Node::Ptr node = AST::Add(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(3));
+    {
+        MemoryScope scope(observer);
+        reducer.reduce(node);
+    }
+
+    EXPECT_THAT(observer.stats().reductionSteps, Eq(2));
+    EXPECT_FALSE(observer.sawNegative);
+}
+
+TEST(MemoryAccounting, ReductionStaysWithinBudget) {
+    DumbReducerService dumbReducer;
+    AccountingReducer reducer(dumbReducer);
+
+    AST::Node::Ptr node = AST::If(
+            AST::LessThan(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(2)),
+            AST::Subtract(AST::Number(1), AST::Number(2)),
+            AST::Add(AST::Number(1), AST::Number(2))
+    );
+    auto programBytes = footprint(*node).liveBytes;
+    reducer.reduce(node);
+
+    MemoryBudget budget{
+            .maxAllocations = 3,
+            .maxPeakLiveBytes = programBytes + static_cast<std::int64_t>(sizeof(AST::NumberNode)),
+            .maxAllocationsPerStep = 1.0,
+    };
+    EXPECT_THAT(budget.violations(reducer.account().stats()), IsEmpty());
+}
+
+TEST(MemoryAccounting, BudgetReportsViolations) {
+    MemoryStats stats;
+    stats.allocations = 10;
+
+    EXPECT_THAT(MemoryBudget{.maxAllocations = 5}.violations(stats), HasSubstr("allocations 10 exceeds 5"));
+}
@@ -0,0 +1,78 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "../src/AST.h"
+#include "../src/normalize.h"
+#include "../src/reductions.h"
+#include "../src/types.h"
+
+using namespace testing;
+
+TEST(Normalization, FlattensAddChainInOrder) {
+    AST::Node::Ptr node = AST::Add(AST::Add(AST::Number(1), AST::Number(2)), AST::Add(AST::Number(3), AST::Number(4)));
+
+    normalize_associative(node);
+
+    auto *sum = node->as<AST::SumNode>();
+    ASSERT_THAT(sum, NotNull());
+    ASSERT_THAT(sum->operands, SizeIs(4));
+    for (int i = 0; i < 4; ++i) EXPECT_THAT(sum->operands[i]->as<AST::NumberNode>()->value, Eq(i + 1));
+}
+
+TEST(Normalization, KeepsSingleBinaryOperations) {
+    AST::Node::Ptr node = AST::Add(AST::Number(1), AST::Subtract(AST::Number(2), AST::Number(3)));
+
+    normalize_associative(node);
+
+    EXPECT_THAT(node->nodeType, Eq(AST::NodeType::ADD));
+}
+
+TEST(Normalization, FlattensNestedChainsSeparately) {
+    AST::Node::Ptr node = AST::If(
+            AST::And(AST::Boolean(true), AST::And(AST::Boolean(true), AST::Or(AST::Boolean(false), AST::Or(AST::Boolean(false), AST::Boolean(true))))),
+            AST::Number(1),
+            AST::Number(2)
+    );
+
+    normalize_associative(node);
+
+    auto *all = node->as<AST::IfNode>()->condition->as<AST::AllNode>();
+    ASSERT_THAT(all, NotNull());
+    ASSERT_THAT(all->operands, SizeIs(3));
+    auto *any = all->operands[2]->as<AST::AnyNode>();
+    ASSERT_THAT(any, NotNull());
+    EXPECT_THAT(any->operands, SizeIs(3));
+}
+
+TEST(Normalization, LongChainReducesInOneStep) {
+    const int length = 5000;
+    AST::Node::Ptr node = AST::Number(0);
+    for (int i = 1; i <= length; ++i) node = AST::Add(std::move(node), AST::Number(i));
+
+    normalize_associative(node);
+    init_types(*node);
+    ASSERT_THAT(node->type, Eq(AST::ValueType::NUMBER));
+    ASSERT_THAT(node->as<AST::SumNode>()->operands, SizeIs(length + 1));
+
+    DumbReducerService reducer(true);
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(length * (length + 1) / 2));
+    EXPECT_THAT(reducer.matchStats().dispatches, Eq(2));
+}
+
+TEST(TypeInitialization, NaryOperands) {
+    AST::Operands numbers;
+    numbers.push_back(AST::Number(1));
+    numbers.push_back(AST::Number(2));
+    auto sum = AST::Sum(std::move(numbers));
+    init_types(*sum);
+    EXPECT_THAT(sum->type, Eq(AST::ValueType::NUMBER));
+
+    AST::Operands mixed;
+    mixed.push_back(AST::Boolean(true));
+    mixed.push_back(AST::Number(2));
+    auto all = AST::All(std::move(mixed));
+    init_types(*all);
+    EXPECT_THAT(all->type, Eq(AST::ValueType::UNKNOWN));
+}
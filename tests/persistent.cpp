@@ -0,0 +1,166 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "../src/AST.h"
+#include "../src/persistent.h"
+#include "../src/reductions.h"
+
+using namespace testing;
+
+TEST(PersistentAST, ReductionKeepsTheSnapshot) {
+    auto program = Persistent::from_ast(*AST::Add(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(3)));
+    Persistent::Ptr snapshot = program;
+
+    auto result = Persistent::reduce(program);
+
+    EXPECT_THAT(Persistent::literal_value(*result), Optional(AST::Value(6)));
+    EXPECT_THAT(snapshot->nodeType, Eq(AST::NodeType::ADD));
+    EXPECT_THAT(snapshot->children[0]->nodeType, Eq(AST::NodeType::ADD));
+}
+
+TEST(PersistentAST, StepSharesUntouchedSubtrees) {
+    auto program = Persistent::from_ast(*AST::Subtract(
+            AST::Add(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(3)),
+            AST::Add(AST::Number(4), AST::Number(5))
+    ));
+
+    auto next = Persistent::reduce_step(program);
+
+    ASSERT_THAT(next, NotNull());
+    // only the path to the reduced Add(1, 2) is copied
+    EXPECT_THAT(next, Ne(program));
+    EXPECT_THAT(next->children[0], Ne(program->children[0]));
+    EXPECT_THAT(next->children[0]->children[1], Eq(program->children[0]->children[1]));
+    EXPECT_THAT(next->children[1], Eq(program->children[1]));
+    EXPECT_THAT(Persistent::literal_value(*next->children[0]->children[0]), Optional(AST::Value(3)));
+}
+
+/// Number of nodes of the new version which are not shared with the previous one
+static std::size_t unshared(const Persistent::Ptr &node, const Persistent::Ptr &previous) {
+    if (node == previous) return 0;
+    std::size_t count = 1;
+    for (std::size_t i = 0; i < node->children.size(); ++i) {
+        count += i < previous->children.size() ? unshared(node->children[i], previous->children[i]) : 1;
+    }
+    return count;
+}
+
+static AST::Node::Ptr wideSum(int width) {
+    AST::Operands operands;
+    for (int i = 0; i < width; ++i) operands.push_back(AST::Add(AST::Number(1), AST::Number(1)));
+    return AST::Sum(std::move(operands));
+}
+
+TEST(PersistentAST, StepInWideNodeCopiesOnlyThePath) {
+    auto program = Persistent::from_ast(*wideSum(8000));
+
+    auto next = Persistent::reduce_step(program);
+
+    ASSERT_THAT(next, NotNull());
+    EXPECT_THAT(program->children.size(), Le(Persistent::GROUP_SIZE));
+    // the root, two levels of operand groups and the reduced operand
+    EXPECT_THAT(unshared(next, program), Eq(4));
+}
+
+TEST(PersistentAST, WideNodeKeepsItsOperands) {
+    auto program = Persistent::from_ast(*wideSum(1000));
+
+    AST::Node::Ptr copy = Persistent::to_ast(*program);
+
+    ASSERT_THAT(copy->as<AST::SumNode>(), NotNull());
+    EXPECT_THAT(copy->as<AST::SumNode>()->operands, SizeIs(1000));
+    EXPECT_THAT(Persistent::literal_value(*Persistent::reduce(program)), Optional(AST::Value(2000)));
+}
+
+TEST(PersistentAST, IfSelectsTheSharedBranch) {
+    auto program = Persistent::from_ast(*AST::If(AST::Boolean(true), AST::Add(AST::Number(1), AST::Number(2)), AST::Number(0)));
+
+    auto next = Persistent::reduce_step(program);
+
+    EXPECT_THAT(next, Eq(program->children[1]));
+}
+
+TEST(PersistentAST, SameResultAsMutableReducers) {
+    auto tree = AST::If(
+            AST::LessThan(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(2)),
+            AST::Subtract(AST::Number(1), AST::Number(2)),
+            AST::Add(AST::Number(1), AST::Number(2))
+    );
+    auto program = Persistent::from_ast(*tree);
+
+    // the snapshot can be handed to any mutable strategy as well
+    AST::Node::Ptr copy = Persistent::to_ast(*program);
+    SmartReducerService().reduce(copy);
+
+    EXPECT_THAT(Persistent::literal_value(*Persistent::reduce(program)), Optional(AST::Value(3)));
+    EXPECT_THAT(AST::literal_value(*copy), Optional(AST::Value(3)));
+}
+
+TEST(PersistentAST, NaryShortCircuit) {
+    AST::Operands operands;
+    operands.push_back(AST::Boolean(true));
+    operands.push_back(AST::GraterThan(AST::Number(1), AST::Number(2)));
+    operands.push_back(AST::Parameter(0));
+    auto program = Persistent::from_ast(*AST::All(std::move(operands)));
+
+    EXPECT_THAT(Persistent::literal_value(*Persistent::reduce(program)), Optional(AST::Value(false)));
+}
+
+TEST(PersistentAST, IrreducibleProgramStops) {
+    auto program = Persistent::from_ast(*AST::Add(AST::Parameter(0), AST::Number(1)));
+
+    EXPECT_THAT(Persistent::reduce_step(program), IsNull());
+    EXPECT_THAT(Persistent::reduce(program), Eq(program));
+}
+
+TEST(PersistentAST, DeepSpineIsReducedInOnePass) {
+    const int depth = 4000;
+    AST::Node::Ptr tree = AST::Number(depth);
+    for (int i = 0; i < depth; ++i) tree = AST::Subtract(std::move(tree), AST::Number(1));
+    auto program = Persistent::from_ast(*tree);
+
+    auto result = Persistent::reduce(program);
+
+    EXPECT_THAT(Persistent::literal_value(*result), Optional(AST::Value(0)));
+    EXPECT_THAT(program->nodeType, Eq(AST::NodeType::SUBTRACT));
+    EXPECT_THAT(program->children[0]->nodeType, Eq(AST::NodeType::SUBTRACT));
+}
+
+static bool same_program(const Persistent::Node &node, const Persistent::Node &other) {
+    if (node.nodeType != other.nodeType || node.value != other.value || node.children.size() != other.children.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < node.children.size(); ++i) {
+        if (!same_program(*node.children[i], *other.children[i])) return false;
+    }
+    return true;
+}
+
+TEST(PersistentAST, PartialReductionMatchesRepeatedSteps) {
+    AST::Operands conditions;
+    conditions.push_back(AST::LessThan(AST::Number(1), AST::Number(2)));
+    conditions.push_back(AST::GraterThan(AST::Parameter(0), AST::Add(AST::Number(1), AST::Number(1))));
+    conditions.push_back(AST::And(AST::Boolean(true), AST::Boolean(false)));
+    auto program = Persistent::from_ast(*AST::If(
+            AST::All(std::move(conditions)),
+            AST::Number(0),
+            AST::Add(AST::Subtract(AST::Number(5), AST::Number(2)), AST::Add(AST::Parameter(1), AST::Number(1)))
+    ));
+
+    Persistent::Ptr stepped = program;
+    while (Persistent::Ptr next = Persistent::reduce_step(stepped)) stepped = std::move(next);
+
+    EXPECT_TRUE(same_program(*Persistent::reduce(program), *stepped));
+}
+
+TEST(PersistentAST, PartialReductionSharesUnchangedSubtrees) {
+    auto program = Persistent::from_ast(*AST::Subtract(
+            AST::Add(AST::Number(1), AST::Number(2)),
+            AST::Add(AST::Parameter(0), AST::Number(1))
+    ));
+
+    auto result = Persistent::reduce(program);
+
+    EXPECT_THAT(Persistent::literal_value(*result->children[0]), Optional(AST::Value(3)));
+    EXPECT_THAT(result->children[1], Eq(program->children[1]));
+}
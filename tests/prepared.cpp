@@ -0,0 +1,99 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "../src/AST.h"
+#include "../src/prepared.h"
+#include "../src/types.h"
+
+using namespace testing;
+
+TEST(TypeInitialization, ParameterTakesDeclaredType) {
+    std::vector<AST::ValueType> parameterTypes{AST::ValueType::NUMBER, AST::ValueType::BOOLEAN};
+    auto node = AST::If(AST::Parameter(1), AST::Parameter(0), AST::Number(2));
+    init_types(*node, parameterTypes);
+    EXPECT_THAT(node->type, Eq(AST::ValueType::NUMBER));
+}
+
+TEST(TypeInitialization, UndeclaredParameterIsUnknown) {
+    auto node = AST::Add(AST::Parameter(0), AST::Number(2));
+    init_types(*node);
+    EXPECT_THAT(node->type, Eq(AST::ValueType::UNKNOWN));
+}
+
+TEST(PreparedProgram, IllTypedProgramIsRejected) {
+    auto node = AST::Add(AST::Parameter(0), AST::Number(2));
+    EXPECT_THAT(PreparedProgram::prepare(*node, {AST::ValueType::BOOLEAN}), Eq(std::nullopt));
+}
+
+TEST(PreparedProgram, PreparingAgainChecksTheNewParameterTypes) {
+    auto node = AST::Add(AST::Parameter(0), AST::Number(2));
+    ASSERT_TRUE(PreparedProgram::prepare(*node, {AST::ValueType::NUMBER}));
+
+    EXPECT_THAT(PreparedProgram::prepare(*node, {AST::ValueType::BOOLEAN}), Eq(std::nullopt));
+}
+
+TEST(PreparedProgram, EvaluatesManyBindings) {
+    // if x < y then y - x else x - y
+    auto node = AST::If(
+            AST::LessThan(AST::Parameter(0), AST::Parameter(1)),
+            AST::Subtract(AST::Parameter(1), AST::Parameter(0)),
+            AST::Subtract(AST::Parameter(0), AST::Parameter(1))
+    );
+    auto program = PreparedProgram::prepare(*node, {AST::ValueType::NUMBER, AST::ValueType::NUMBER});
+    ASSERT_TRUE(program);
+    EXPECT_THAT(program->type(), Eq(AST::ValueType::NUMBER));
+
+    for (int x = -5; x <= 5; ++x) {
+        for (int y = -5; y <= 5; ++y) {
+            std::vector<AST::Value> arguments{x, y};
+            EXPECT_THAT(program->evaluate(arguments), Eq(AST::Value(std::abs(x - y))));
+        }
+    }
+}
+
+TEST(PreparedProgram, BooleanParametersAndResult) {
+    auto node = AST::If(AST::Parameter(0), AST::GraterThan(AST::Parameter(1), AST::Number(0)), AST::Boolean(false));
+    auto program = PreparedProgram::prepare(*node, {AST::ValueType::BOOLEAN, AST::ValueType::NUMBER});
+    ASSERT_TRUE(program);
+
+    std::vector<AST::Value> whenTrue{true, 3};
+    std::vector<AST::Value> whenFalse{false, 3};
+    EXPECT_THAT(program->evaluate(whenTrue), Eq(AST::Value(true)));
+    EXPECT_THAT(program->evaluate(whenFalse), Eq(AST::Value(false)));
+}
+
+TEST(PreparedProgram, EvaluatesColumns) {
+    auto node = AST::Add(AST::Parameter(0), AST::Add(AST::Parameter(1), AST::Number(100)));
+    auto program = PreparedProgram::prepare(*node, {AST::ValueType::NUMBER, AST::ValueType::NUMBER});
+    ASSERT_TRUE(program);
+
+    std::vector<int> xs{1, 2, 3};
+    std::vector<int> ys{10, 20, 30};
+    std::vector<std::span<const int>> columns{xs, ys};
+
+    EXPECT_THAT(program->evaluate(columns, 3), ElementsAre(AST::Value(111), AST::Value(122), AST::Value(133)));
+}
+
+TEST(PreparedProgram, ProgramWithoutParameters) {
+    auto node = AST::Subtract(AST::Number(1), AST::Number(3));
+    auto program = PreparedProgram::prepare(*node, {});
+    ASSERT_TRUE(program);
+
+    EXPECT_THAT(program->evaluate(std::span<const AST::Value>{}), Eq(AST::Value(-2)));
+}
+
+TEST(PreparedProgram, NaryOperations) {
+    AST::Operands operands;
+    operands.push_back(AST::Parameter(0));
+    operands.push_back(AST::Number(2));
+    operands.push_back(AST::Parameter(0));
+    AST::Operands conditions;
+    conditions.push_back(AST::Boolean(false));
+    conditions.push_back(AST::Any({}));
+    auto node = AST::If(AST::All(std::move(conditions)), AST::Number(0), AST::Sum(std::move(operands)));
+    auto program = PreparedProgram::prepare(*node, {AST::ValueType::NUMBER});
+    ASSERT_TRUE(program);
+
+    std::vector<AST::Value> arguments{5};
+    EXPECT_THAT(program->evaluate(arguments), Eq(AST::Value(12)));
+}
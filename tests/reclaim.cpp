@@ -0,0 +1,118 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "../src/AST.h"
+#include "../src/cache.h"
+#include "../src/memory.h"
+#include "../src/reclaim.h"
+#include "../src/reductions.h"
+
+using namespace testing;
+
+static AST::Node::Ptr programWithDeadBranch() {
+    return AST::If(
+            AST::LessThan(AST::Number(1), AST::Number(2)),
+            AST::Add(AST::Number(1), AST::Number(2)),
+            AST::Subtract(AST::Subtract(AST::Number(5), AST::Number(4)), AST::Number(3))
+    );
+}
+
+TEST(DeferredReclaimer, BatchedModeReleasesOnFlush) {
+    SmartReducerService smartReducer;
+    DeferredReclaimer reclaimer(DeferredReclaimer::Mode::BATCHED);
+    ReclaimingReducer reducer(smartReducer, reclaimer, false);
+    MemoryAccount account;
+    AST::Node::Ptr node = programWithDeadBranch();
+    auto programNodes = footprint(*node).nodesCreated;
+
+    {
+        MemoryScope scope(account);
+        reducer.reduce(node);
+        ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(3));
+
+        // the dead branch is still alive, only waiting to be reclaimed
+        EXPECT_THAT(account.stats().live(AST::NodeType::SUBTRACT), Eq(0));
+        // the reduced LessThan and Add, with their operands, are small enough to be freed inline
+        EXPECT_THAT(account.stats().nodesDestroyed, Eq(6));
+        EXPECT_THAT(reclaimer.discardedCount(), Eq(1));
+        EXPECT_THAT(reclaimer.reclaimedCount(), Eq(0));
+
+        reclaimer.flush();
+    }
+
+    EXPECT_THAT(reclaimer.reclaimedCount(), Eq(1));
+    // everything except the result has been freed: the created literals and the whole input program
+    EXPECT_THAT(account.stats().nodesDestroyed, Eq(account.stats().nodesCreated + programNodes - 1));
+}
+
+TEST(DeferredReclaimer, BatchedModeFlushesAfterReduceByDefault) {
+    DumbReducerService dumbReducer;
+    DeferredReclaimer reclaimer(DeferredReclaimer::Mode::BATCHED);
+    ReclaimingReducer reducer(dumbReducer, reclaimer);
+
+    AST::Node::Ptr node = programWithDeadBranch();
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(3));
+    EXPECT_THAT(reclaimer.reclaimedCount(), Eq(reclaimer.discardedCount()));
+}
+
+TEST(DeferredReclaimer, BackgroundModeReclaimsOnAnotherThread) {
+    SmartReducerService smartReducer;
+    DeferredReclaimer reclaimer(DeferredReclaimer::Mode::BACKGROUND);
+    ReclaimingReducer reducer(smartReducer, reclaimer);
+
+    for (int i = 0; i < 100; ++i) {
+        AST::Node::Ptr node = programWithDeadBranch();
+        reducer.reduce(node);
+        ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(3));
+    }
+    reclaimer.flush();
+
+    EXPECT_THAT(reclaimer.discardedCount(), Eq(100));
+    EXPECT_THAT(reclaimer.reclaimedCount(), Eq(100));
+}
+
+TEST(DeferredReclaimer, SmallSubtreesAreFreedInline) {
+    SmartReducerService smartReducer;
+    DeferredReclaimer reclaimer(DeferredReclaimer::Mode::BATCHED);
+    ReclaimingReducer reducer(smartReducer, reclaimer, false);
+
+    AST::Node::Ptr node = AST::If(AST::LessThan(AST::Number(1), AST::Number(2)), AST::Subtract(AST::Number(5), AST::Number(4)), AST::Number(0));
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(1));
+    EXPECT_THAT(reclaimer.discardedCount(), Eq(0));
+}
+
+TEST(DeferredReclaimer, CachedSubtreesAreReclaimed) {
+    SmartReducerService smartReducer;
+    EvaluationCache cache(16);
+    CachingReducer cachingReducer(smartReducer, cache);
+    DeferredReclaimer reclaimer(DeferredReclaimer::Mode::BATCHED);
+    ReclaimingReducer reducer(cachingReducer, reclaimer, false);
+
+    AST::Node::Ptr first = programWithDeadBranch();
+    cachingReducer.reduce(first);
+    AST::Node::Ptr second = programWithDeadBranch();
+    reducer.reduce(second);
+
+    ASSERT_THAT(second->as<AST::NumberNode>()->value, Eq(3));
+    // the whole program is replaced by its cached value, and handed to the reclaimer
+    EXPECT_THAT(reclaimer.discardedCount(), Eq(1));
+}
+
+TEST(DeferredReclaimer, WithoutReclaimerSubtreesAreFreedImmediately) {
+    SmartReducerService reducer;
+    MemoryAccount account;
+    AST::Node::Ptr node = programWithDeadBranch();
+    account.adopt(footprint(*node));
+
+    {
+        MemoryScope scope(account);
+        reducer.reduce(node);
+    }
+
+    EXPECT_THAT(activeReclaimer, IsNull());
+    EXPECT_THAT(account.stats().live(AST::NodeType::SUBTRACT), Eq(0));
+}
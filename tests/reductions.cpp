@@ -202,6 +202,91 @@ TEST_P(ReductionTest, IfSubtractAndAddNodesTogether){
 }
 
 
+TEST_P(ReductionTest, OrWithComplexRight) {
+    AST::Node::Ptr node = AST::Or(AST::Boolean(false), AST::Or(AST::Boolean(false), AST::Boolean(true)));
+
+    reducer->reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::BOOLEAN_LITERAL));
+    ASSERT_THAT(node->as<AST::BooleanNode>()->value, Eq(true));
+}
+
+TEST_P(ReductionTest, SumOfManyOperands) {
+    AST::Operands operands;
+    for (int i = 1; i <= 100; ++i) operands.push_back(AST::Number(i));
+    operands.push_back(AST::Sum({}));
+    operands.push_back(AST::Subtract(AST::Number(0), AST::Number(50)));
+    AST::Node::Ptr node = AST::Sum(std::move(operands));
+
+    reducer->reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::NUMBER_LITERAL));
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(5000));
+}
+
+TEST_P(ReductionTest, AllStopsAtFirstFalse) {
+    AST::Operands operands;
+    operands.push_back(AST::LessThan(AST::Number(1), AST::Number(2)));
+    operands.push_back(AST::Boolean(false));
+    // irreducible, so the result would not be a literal if it was reduced
+    operands.push_back(AST::Parameter(0));
+    AST::Node::Ptr node = AST::All(std::move(operands));
+
+    reducer->reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::BOOLEAN_LITERAL));
+    ASSERT_THAT(node->as<AST::BooleanNode>()->value, Eq(false));
+}
+
+TEST_P(ReductionTest, AnyStopsAtFirstTrue) {
+    AST::Operands operands;
+    operands.push_back(AST::Boolean(false));
+    operands.push_back(AST::GraterThan(AST::Number(3), AST::Number(2)));
+    operands.push_back(AST::Parameter(0));
+    AST::Node::Ptr node = AST::Any(std::move(operands));
+
+    reducer->reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::BOOLEAN_LITERAL));
+    ASSERT_THAT(node->as<AST::BooleanNode>()->value, Eq(true));
+}
+
+TEST_P(ReductionTest, ProgramWithParameterStops) {
+    AST::Node::Ptr node = AST::Add(AST::Parameter(0), AST::Number(1));
+
+    reducer->reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::ADD));
+    ASSERT_THAT(node->as<AST::AddNode>()->left->nodeType, Eq(AST::NodeType::PARAMETER));
+}
+
+TEST_P(ReductionTest, ProgramWithParameterIsPartiallyReduced) {
+    AST::Node::Ptr node = AST::If(
+            AST::LessThan(AST::Add(AST::Number(1), AST::Number(2)), AST::Parameter(0)),
+            AST::Number(1),
+            AST::Number(2)
+    );
+
+    reducer->reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::IF));
+    auto *condition = node->as<AST::IfNode>()->condition->as<AST::LessThanNode>();
+    ASSERT_THAT(condition, NotNull());
+    ASSERT_THAT(AST::literal_value(*condition->left), Optional(AST::Value(3)));
+}
+
+TEST_P(ReductionTest, EmptyAllAndAny) {
+    AST::Node::Ptr all = AST::All({});
+    AST::Node::Ptr any = AST::Any({});
+
+    reducer->reduce(all);
+    reducer->reduce(any);
+
+    ASSERT_THAT(all->as<AST::BooleanNode>()->value, Eq(true));
+    ASSERT_THAT(any->as<AST::BooleanNode>()->value, Eq(false));
+}
+
+
 INSTANTIATE_TEST_SUITE_P(ReductionTests, ReductionTest, Values(
         std::make_shared<DumbReducerService>(),
         std::make_shared<SmartReducerService>()
@@ -219,3 +304,102 @@ INSTANTIATE_TEST_SUITE_P(ReductionTests, ReductionTest, Values(
 
 
 
+
+
+/// Binds every parameter to the same number
+struct BindParameterReduction : public IReductionRule {
+    int value;
+
+    explicit BindParameterReduction(int value) : value(value) {}
+
+    bool reduce(AST::Node::Ptr &node) const override {
+        if (!node->as<AST::ParameterNode>()) return false;
+        node = AST::Number(value);
+        return true;
+    }
+};
+
+TEST(SimdSum, MatchesScalarSum) {
+    std::vector<int> numbers;
+    for (int i = 0; i < 37; ++i) {
+        EXPECT_THAT(simd_sum(numbers), Eq(i * (i - 1) / 2));
+        numbers.push_back(i);
+    }
+}
+
+TEST(NaryReduction, ReportsPartiallyReducedOperands) {
+    SmartReducerService reducer;
+    SumReduction sumReduction{reducer};
+    AllReduction allReduction{reducer};
+
+    AST::Operands numbers;
+    numbers.push_back(AST::Add(AST::Number(1), AST::Number(2)));
+    numbers.push_back(AST::Parameter(0));
+    AST::Node::Ptr sum = AST::Sum(std::move(numbers));
+    AST::Operands conditions;
+    conditions.push_back(AST::LessThan(AST::Number(1), AST::Number(2)));
+    conditions.push_back(AST::Parameter(0));
+    AST::Node::Ptr all = AST::All(std::move(conditions));
+
+    EXPECT_TRUE(sumReduction.reduce(sum));
+    EXPECT_TRUE(allReduction.reduce(all));
+    ASSERT_THAT(AST::literal_value(*sum->as<AST::SumNode>()->operands[0]), Optional(AST::Value(3)));
+    ASSERT_THAT(AST::literal_value(*all->as<AST::AllNode>()->operands[0]), Optional(AST::Value(true)));
+
+    EXPECT_FALSE(sumReduction.reduce(sum));
+    EXPECT_FALSE(allReduction.reduce(all));
+}
+
+TEST(RuleRegistry, DispatchesFewerAttemptsThanLinearScan) {
+    DumbReducerService reducer(true);
+    AST::Node::Ptr node = AST::If(
+            AST::LessThan(AST::Add(AST::Number(1), AST::Number(2)), AST::Number(2)),
+            AST::Subtract(AST::Number(1), AST::Number(2)),
+            AST::Add(AST::Number(1), AST::Number(2))
+    );
+
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(3));
+    auto stats = reducer.matchStats();
+    EXPECT_THAT(stats.attempts, Le(stats.dispatches));
+    EXPECT_THAT(stats.saved(), Gt(0));
+}
+
+TEST(RuleRegistry, OnlyMatchingRulesAreAttempted) {
+    RuleRegistry registry(true);
+    registry.add(std::make_unique<AddSimpleReduction>());
+    registry.add(std::make_unique<SubtractSimpleReduction>());
+    registry.add(std::make_unique<OrSimpleReduction>());
+
+    AST::Node::Ptr node = AST::Or(AST::Boolean(false), AST::Boolean(true));
+    ASSERT_TRUE(registry.apply(node));
+    ASSERT_FALSE(registry.apply(node));
+
+    ASSERT_THAT(node->as<AST::BooleanNode>()->value, Eq(true));
+    auto stats = registry.matchStats();
+    EXPECT_THAT(stats.dispatches, Eq(2));
+    EXPECT_THAT(stats.attempts, Eq(1));
+    EXPECT_THAT(stats.linearAttempts, Eq(6));
+}
+
+TEST(RuleRegistry, MatchesAreNotCountedByDefault) {
+    DumbReducerService reducer;
+    AST::Node::Ptr node = AST::Add(AST::Number(1), AST::Number(2));
+
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(3));
+    EXPECT_THAT(reducer.matchStats().dispatches, Eq(0));
+}
+
+TEST(RuleRegistry, CustomRulesCanBeAddedAtRuntime) {
+    DumbReducerService reducer;
+    reducer.addRule(std::make_unique<BindParameterReduction>(42));
+
+    AST::Node::Ptr node = AST::Add(AST::Parameter(0), AST::Number(1));
+    reducer.reduce(node);
+
+    ASSERT_THAT(node->nodeType, Eq(AST::NodeType::NUMBER_LITERAL));
+    ASSERT_THAT(node->as<AST::NumberNode>()->value, Eq(43));
+}